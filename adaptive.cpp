@@ -0,0 +1,217 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "adaptive.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// bounds of the tuned settings, relative to where they started
+constexpr double MIN_EXPANSION_BIAS = 0.1;
+constexpr double MAX_EXPANSION_BIAS = 4.0;
+constexpr size_t MAX_GROWTH = 8; // maxSteps and maxLen grow to at most this many times their start
+constexpr double MIN_LEFTMOST = 0.3;
+constexpr double MIN_BIAS_STEP = 0.02; // below this the bias counts as settled
+
+// a failure share that triggers a change, and the new-string rate counted as mostly repeats
+constexpr double FAILURE_SHARE = 0.2;
+constexpr double FRESH_RATE = 0.25;
+
+// a push towards longer strings that leaves fewer than this share of the new strings
+// per second is undone, and not retried for REVERT_COOLDOWN batches
+constexpr double REVERT_SLOWDOWN = 0.8;
+constexpr size_t REVERT_COOLDOWN = 8;
+
+GenTuner::GenTuner(const GenSettings& initial, std::string name)
+    : cfg(initial), initial(initial), name(std::move(name)), resumed(std::chrono::steady_clock::now())
+{
+}
+
+void GenTuner::resume()
+{
+    resumed = std::chrono::steady_clock::now();
+}
+
+void GenTuner::pause()
+{
+    seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - resumed).count();
+}
+
+const GenSettings& GenTuner::settings() const
+{
+    return cfg;
+}
+
+void GenTuner::record(const std::vector<SymbolId>* w, GenFailure failure, bool isFresh)
+{
+    ++trials;
+    if (w)
+    {
+        ++produced;
+        if (isFresh)
+            ++fresh;
+        if (w->size() >= lengths.size())
+            lengths.resize(w->size() + 1, 0);
+        ++lengths[w->size()];
+    }
+    else if (failure == GenFailure::StepLimit)
+    {
+        ++stepLimit;
+    }
+    else if (failure == GenFailure::MaxLen)
+    {
+        ++lengthLimit;
+    }
+}
+
+// smallest length with at least a fraction q of the produced strings at or below it
+size_t GenTuner::lengthQuantile(double q) const
+{
+    const double target = q * static_cast<double>(produced);
+    size_t below = 0;
+    for (size_t n = 0; n < lengths.size(); ++n)
+    {
+        below += lengths[n];
+        if (static_cast<double>(below) >= target)
+            return n;
+    }
+    return lengths.empty() ? 0 : lengths.size() - 1;
+}
+
+bool GenTuner::retune(std::vector<std::string>& log)
+{
+    if (trials < TUNING_BATCH)
+        return false;
+
+    const double n = static_cast<double>(trials);
+    const double stepShare = static_cast<double>(stepLimit) / n;
+    const double lengthShare = static_cast<double>(lengthLimit) / n;
+    const double successRate = static_cast<double>(produced) / n;
+    const double freshRate = static_cast<double>(fresh) / n;
+    const size_t median = lengthQuantile(0.5);
+
+    pause();
+    resume();
+    const double rate = seconds > 0.0 ? static_cast<double>(fresh) / seconds : 0.0;
+
+    const GenSettings before = cfg;
+    std::string reason;
+    const bool wasProbing = probing;
+    probing = false;
+
+    // the bias and targetMax are pushed both ways by different rules; each step is
+    // halved when its direction flips, so they settle instead of oscillating
+    auto moveBias = [&](int sign)
+    {
+        if (biasSign != 0 && sign != biasSign)
+            biasStep /= 2.0;
+        biasSign = sign;
+        if (biasStep < MIN_BIAS_STEP)
+            return;
+        const double factor = sign > 0 ? 1.0 + biasStep : 1.0 / (1.0 + biasStep);
+        cfg.expansionBias = std::clamp(cfg.expansionBias * factor, MIN_EXPANSION_BIAS, MAX_EXPANSION_BIAS);
+    };
+    auto moveTargetMax = [&](int sign)
+    {
+        if (targetSign != 0 && sign != targetSign)
+            targetStep /= 2;
+        targetSign = sign;
+        if (sign > 0)
+            cfg.targetMax = std::min(cfg.maxLen, cfg.targetMax + targetStep);
+        else
+            cfg.targetMax = std::max(cfg.targetMin, cfg.targetMax - std::min(targetStep, cfg.targetMax));
+    };
+    auto growMaxLen = [&]()
+    {
+        cfg.maxLen = std::min(cfg.maxLen + cfg.maxLen / 4 + 1, initial.maxLen * MAX_GROWTH);
+    };
+
+    if (wasProbing && rate < rateBeforeProbe * REVERT_SLOWDOWN)
+    {
+        reason = "fewer new strings per second, undone";
+        cfg = beforeProbe;
+        cooldown = REVERT_COOLDOWN;
+    }
+    else if (stepShare >= FAILURE_SHARE)
+    {
+        reason = "step limit";
+        if (cfg.expansionBias > MIN_EXPANSION_BIAS && biasStep >= MIN_BIAS_STEP)
+            moveBias(-1);
+        else
+            cfg.maxSteps = std::min(cfg.maxSteps * 2, initial.maxSteps * MAX_GROWTH);
+    }
+    else if (lengthShare >= FAILURE_SHARE)
+    {
+        // a longer maxLen would make every parse dearer, so only steer the derivations
+        reason = "length limit";
+        moveTargetMax(-1);
+        if (cfg.expansionBias > MIN_EXPANSION_BIAS)
+            moveBias(-1);
+    }
+    else if (cooldown > 0)
+    {
+        --cooldown;
+    }
+    else if (successRate >= 0.5 && freshRate < FRESH_RATE)
+    {
+        // short strings run out first, so raise the floor as well
+        reason = "repeated strings";
+        moveBias(1);
+        // kept on a grid of tenths so repeated steps land exactly on the floor
+        cfg.pLeftmost = std::max(MIN_LEFTMOST, std::round(cfg.pLeftmost * 10.0 - 1.0) / 10.0);
+        if (cfg.targetMax >= cfg.maxLen)
+            growMaxLen();
+        moveTargetMax(1);
+        cfg.targetMin = std::min(cfg.targetMax / 2, std::max(cfg.targetMin + 1, median + 1));
+        cfg.targetMin = std::max(cfg.targetMin, before.targetMin);
+
+        probing = true;
+        beforeProbe = before;
+        rateBeforeProbe = rate;
+    }
+
+    const bool changed = cfg.maxSteps != before.maxSteps || cfg.maxLen != before.maxLen ||
+                         cfg.targetMin != before.targetMin || cfg.targetMax != before.targetMax ||
+                         cfg.pLeftmost != before.pLeftmost || cfg.expansionBias != before.expansionBias;
+
+    if (changed)
+    {
+        std::ostringstream line;
+        line << name << " batch " << batches + 1 << ": " << produced << "/" << trials << " derived, "
+             << fresh << " new (" << static_cast<long long>(rate) << "/s), " << stepLimit << " over steps, "
+             << lengthLimit << " over length, median length " << median << "; " << reason << ":";
+        auto change = [&](const char* knob, auto from, auto to)
+        {
+            if (from != to)
+                line << " " << knob << " " << from << " -> " << to;
+        };
+        change("maxSteps", before.maxSteps, cfg.maxSteps);
+        change("maxLen", before.maxLen, cfg.maxLen);
+        change("targetMin", before.targetMin, cfg.targetMin);
+        change("targetMax", before.targetMax, cfg.targetMax);
+        change("pLeftmost", before.pLeftmost, cfg.pLeftmost);
+        change("bias", before.expansionBias, cfg.expansionBias);
+        log.push_back(line.str());
+    }
+
+    ++batches;
+    trials = produced = fresh = stepLimit = lengthLimit = 0;
+    seconds = 0.0;
+    std::fill(lengths.begin(), lengths.end(), 0);
+
+    return cfg.expansionBias != before.expansionBias;
+}
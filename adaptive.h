@@ -0,0 +1,96 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ADAPTIVE_H__
+#define __ADAPTIVE_H__
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "cyk.h"
+
+// trials per direction between two tuning decisions
+constexpr size_t TUNING_BATCH = 250;
+
+/*
+ * GenTuner retunes the settings of the random generator for one grammar during a
+ * search (--adaptive). it counts the outcome of every trial, and after each batch
+ * of TUNING_BATCH trials it looks at the success rate, the rate of new distinct
+ * strings and the length histogram of the batch:
+ *  - many derivations hitting the step limit make finishing alternatives more likely
+ *    (a lower expansionBias), and once that is at its floor, maxSteps grows
+ *  - many derivations going over maxLen do the same and lower targetMax
+ *  - derivations that mostly succeed but repeat strings already seen push towards
+ *    longer strings: higher targets and bias, more random expansion order (pLeftmost)
+ * longer strings are new more often but cost more to parse, so a push towards them is
+ * kept only if the next batch finds at least as many new strings per second (within
+ * REVERT_SLOWDOWN). otherwise it is undone and not tried again for a while. because
+ * of that timing, adaptive searches are not reproducible run to run. every change is
+ * described in a log line.
+ */
+class GenTuner
+{
+public:
+    GenTuner(const GenSettings& initial, std::string name);
+
+    const GenSettings& settings() const;
+
+    // one trial: the string drawn (or null if the derivation failed) and whether it was new
+    void record(const std::vector<SymbolId>* w, GenFailure failure, bool fresh);
+
+    // at the end of a batch, retune and describe the change in log. true if the
+    // expansion bias changed, so the caller has to reweight its rule map
+    bool retune(std::vector<std::string>& log);
+
+    // only time between resume and pause counts towards a batch, so the rounds
+    // of the other direction are not charged to this one
+    void resume();
+    void pause();
+
+private:
+    GenSettings cfg;
+    GenSettings initial;
+    std::string name;
+    size_t batches = 0;
+
+    // step sizes and last directions of the two settings tuned both ways
+    double biasStep = 0.25;
+    int biasSign = 0;
+    size_t targetStep = 4;
+    int targetSign = 0;
+
+    // the last push towards longer strings, kept until the next batch confirms it
+    bool probing = false;
+    GenSettings beforeProbe;
+    double rateBeforeProbe = 0.0; // new strings per second
+    size_t cooldown = 0; // batches before longer strings may be tried again
+
+    std::chrono::steady_clock::time_point resumed;
+    double seconds = 0.0; // of the current batch
+
+    // counts of the current batch
+    size_t trials = 0;
+    size_t produced = 0;
+    size_t fresh = 0;
+    size_t stepLimit = 0;
+    size_t lengthLimit = 0;
+    std::vector<size_t> lengths; // produced strings by length
+
+    size_t lengthQuantile(double q) const;
+};
+
+#endif
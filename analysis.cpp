@@ -0,0 +1,159 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "analysis.h"
+#include <queue>
+#include <functional>
+#include <algorithm>
+
+/*
+ * Dowling and Gallier's linear propagation. each enabled production keeps a count of
+ * its nonterminal occurrences that are not yet resolved. resolving a nonterminal
+ * decrements the count of every production it occurs in, and a production whose count
+ * reaches zero resolves its lhs. every occurrence is touched once, so the whole pass
+ * is linear in the size of the grammar.
+ */
+static std::vector<bool> propagate(const Grammar& g, const std::function<bool(uint32_t)>& enabled)
+{
+	std::vector<bool> resolved(g.byLhs.size(), false);
+	std::vector<size_t> pending = g.prodNonterminals;
+	std::vector<SymbolId> worklist;
+
+	auto resolve = [&](SymbolId A)
+	{
+		if (!resolved[A])
+		{
+			resolved[A] = true;
+			worklist.push_back(A);
+		}
+	};
+
+	for (uint32_t p = 0; p < g.prodLhs.size(); ++p)
+	{
+		if (enabled(p) && pending[p] == 0)
+			resolve(g.prodLhs[p]);
+	}
+
+	while (!worklist.empty())
+	{
+		const SymbolId B = worklist.back();
+		worklist.pop_back();
+
+		for (uint32_t p : g.uses[B])
+		{
+			if (enabled(p) && --pending[p] == 0)
+				resolve(g.prodLhs[p]);
+		}
+	}
+
+	return resolved;
+}
+
+std::vector<bool> nullableSet(const Grammar& g)
+{
+	// a production containing a terminal can never derive epsilon
+	return propagate(g, [&g](uint32_t p) { return g.prodTerminals[p] == 0; });
+}
+
+std::vector<bool> generatingSet(const Grammar& g)
+{
+	return propagate(g, [](uint32_t) { return true; });
+}
+
+std::vector<bool> reachableSet(const Grammar& g, SymbolId start)
+{
+	return reachableSet(g, start, std::vector<bool>(g.byLhs.size(), true));
+}
+
+std::vector<bool> reachableSet(const Grammar& g, SymbolId start, const std::vector<bool>& allowed)
+{
+	std::vector<bool> reach(g.byLhs.size(), false);
+	if (start >= g.byLhs.size() || !allowed[start])
+		return reach;
+
+	std::vector<SymbolId> worklist{ start };
+	reach[start] = true;
+
+	while (!worklist.empty())
+	{
+		const SymbolId A = worklist.back();
+		worklist.pop_back();
+
+		for (uint32_t p : g.byLhs[A])
+		{
+			const auto& prod = g.production(p);
+			const bool usable = std::all_of(prod.begin(), prod.end(),
+				[&](const Symbol& s) { return s.isTerminal || allowed[s.id]; });
+			if (!usable)
+				continue;
+
+			for (const Symbol& s : prod)
+			{
+				if (!s.isTerminal && !reach[s.id])
+				{
+					reach[s.id] = true;
+					worklist.push_back(s.id);
+				}
+			}
+		}
+	}
+
+	return reach;
+}
+
+/*
+ * Knuth's generalization of Dijkstra's algorithm. the same counters decide when a
+ * production's length is known (all its nonterminals fixed), and a priority queue
+ * fixes nonterminals shortest first, so the first length popped for a nonterminal
+ * is its minimum.
+ */
+std::vector<size_t> minYieldLengths(const Grammar& g)
+{
+	std::vector<size_t> best(g.byLhs.size(), SIZE_MAX);
+	std::vector<bool> fixed(g.byLhs.size(), false);
+	std::vector<size_t> pending = g.prodNonterminals;
+	std::vector<size_t> length = g.prodTerminals;
+
+	using Entry = std::pair<size_t, SymbolId>;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+	for (uint32_t p = 0; p < g.prodLhs.size(); ++p)
+	{
+		if (pending[p] == 0)
+			queue.push({ length[p], g.prodLhs[p] });
+	}
+
+	while (!queue.empty())
+	{
+		const auto [len, A] = queue.top();
+		queue.pop();
+		if (fixed[A])
+			continue;
+
+		fixed[A] = true;
+		best[A] = len;
+
+		for (uint32_t p : g.uses[A])
+		{
+			length[p] += len;
+			if (--pending[p] == 0 && !fixed[g.prodLhs[p]])
+				queue.push({ length[p], g.prodLhs[p] });
+		}
+	}
+
+	return best;
+}
@@ -0,0 +1,45 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ANALYSIS_H__
+#define __ANALYSIS_H__
+
+#include <cstdint>
+#include <vector>
+#include "grammar.h"
+
+/*
+ * fixpoint analyses over the index of a grammar (see Grammar::buildIndex), which
+ * must be current: a pass that changed the rules rebuilds it before asking
+ */
+
+// nonterminals that derive the empty string
+std::vector<bool> nullableSet(const Grammar& g);
+
+// nonterminals that derive some string of terminals
+std::vector<bool> generatingSet(const Grammar& g);
+
+// nonterminals that occur in some sentential form of start
+std::vector<bool> reachableSet(const Grammar& g, SymbolId start);
+
+// the same, using only allowed nonterminals and the productions made of them
+std::vector<bool> reachableSet(const Grammar& g, SymbolId start, const std::vector<bool>& allowed);
+
+// length of the shortest terminal string each nonterminal derives, SIZE_MAX if none
+std::vector<size_t> minYieldLengths(const Grammar& g);
+
+#endif
@@ -0,0 +1,508 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * benchmark harness for the hot paths of cfg_comparator: every CNF pass, the CYK
+ * index and parsers, the string generator and a whole counterexample search.
+ * it runs on the grammar files given on the command line and on scaled copies of
+ * them, and prints one JSON object with ns/op, allocations/op and throughput per
+ * measurement. progress goes to stderr so the JSON can be redirected on its own.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <cstdlib>
+#include <cstdio>
+#include <new>
+#include <algorithm>
+#include <random>
+#include "parser.h"
+#include "cnf.h"
+#include "cyk.h"
+#include "uniform.h"
+#include "source.h"
+
+// every allocation in the process goes through here so it can be counted
+static std::atomic<uint64_t> allocationCount{ 0 };
+
+void* operator new(std::size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+// same trial count and seed as the search in main.cpp
+constexpr size_t BENCH_TRIALS = 5000;
+constexpr uint64_t BENCH_SEED = 1874592;
+
+constexpr size_t CYK_MIN_LENGTH = 8;
+constexpr size_t CYK_MAX_LENGTH = 512;
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions
+{
+	double minSeconds = 0.05; // per measurement, at least one op always runs
+	std::vector<size_t> scales{ 1, 10, 100 };
+	std::vector<std::string> files;
+};
+
+struct Measurement
+{
+	size_t iterations = 0;
+	double nsPerOp = 0.0;
+	double allocsPerOp = 0.0;
+};
+
+struct BenchResult
+{
+	std::string name;
+	std::string input;
+	size_t scale = 1;
+	size_t length = 0; // string length for the CYK measurements, 0 otherwise
+	Measurement m;
+	double itemsPerOp = 1.0; // what throughput counts, per op
+	std::string unit;
+};
+
+static double secondsSince(Clock::time_point start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+/*
+ * run body in growing batches until minSeconds have passed. for ops too cheap to
+ * time one by one; body must leave its inputs as it found them
+ */
+static Measurement measure(double minSeconds, const std::function<void()>& body)
+{
+	Measurement m;
+	size_t batch = 1;
+	double elapsed = 0.0;
+	uint64_t allocs = 0;
+	while (elapsed < minSeconds)
+	{
+		const uint64_t a0 = allocationCount.load(std::memory_order_relaxed);
+		const auto t0 = Clock::now();
+		for (size_t i = 0; i < batch; ++i)
+			body();
+		elapsed += secondsSince(t0);
+		allocs += allocationCount.load(std::memory_order_relaxed) - a0;
+		m.iterations += batch;
+		batch *= 2;
+	}
+	m.nsPerOp = elapsed * 1e9 / static_cast<double>(m.iterations);
+	m.allocsPerOp = static_cast<double>(allocs) / static_cast<double>(m.iterations);
+	return m;
+}
+
+/*
+ * like measure, for ops that consume their input: setup makes a fresh input before
+ * every op and only body is timed and counted
+ */
+static Measurement measureEach(double minSeconds, const Grammar& input, const std::function<void(Grammar&)>& body)
+{
+	Measurement m;
+	double elapsed = 0.0;
+	uint64_t allocs = 0;
+	while (elapsed < minSeconds)
+	{
+		Grammar g = input;
+		const uint64_t a0 = allocationCount.load(std::memory_order_relaxed);
+		const auto t0 = Clock::now();
+		body(g);
+		elapsed += secondsSince(t0);
+		allocs += allocationCount.load(std::memory_order_relaxed) - a0;
+		++m.iterations;
+	}
+	m.nsPerOp = elapsed * 1e9 / static_cast<double>(m.iterations);
+	m.allocsPerOp = static_cast<double>(allocs) / static_cast<double>(m.iterations);
+	return m;
+}
+
+static size_t productionCount(const Grammar& g)
+{
+	size_t n = 0;
+	for (const auto& r : g.rules)
+		n += r.rhs.size();
+	return n;
+}
+
+/*
+ * the union of `copies` renamed copies of g under a new start symbol S@ -> S@0 | S@1 | ...
+ * nonterminals are renamed per copy while terminals are shared, so the language is
+ * unchanged and strings of g exercise the scaled grammar too
+ */
+static Grammar scaleGrammar(const Grammar& g, size_t copies)
+{
+	if (copies <= 1)
+		return g;
+
+	Grammar out;
+	std::vector<SymbolId> terminalMap(g.symbols.terminalCount(), EPSILON_ID);
+	for (SymbolId t = 1; t < g.symbols.terminalCount(); ++t)
+		terminalMap[t] = out.symbols.internTerminal(g.symbols.terminalName(t));
+	for (SymbolId t : g.terminals)
+		out.terminals.insert(terminalMap[t]);
+
+	Rule top;
+	top.lhs = out.symbols.internNonterminal("S@");
+	out.nonterminals.insert(top.lhs);
+	out.rules.push_back(top);
+
+	for (size_t k = 0; k < copies; ++k)
+	{
+		const std::string suffix = "@" + std::to_string(k);
+		std::vector<SymbolId> nonterminalMap(g.symbols.nonterminalCount());
+		for (SymbolId a = 0; a < g.symbols.nonterminalCount(); ++a)
+			nonterminalMap[a] = out.symbols.internNonterminal(g.symbols.nonterminalName(a) + suffix);
+
+		out.rules.front().rhs.push_back({ Symbol{ false, nonterminalMap[g.start] } });
+		for (const auto& r : g.rules)
+		{
+			Rule copy;
+			copy.lhs = nonterminalMap[r.lhs];
+			out.nonterminals.insert(copy.lhs);
+			for (const auto& prod : r.rhs)
+			{
+				std::vector<Symbol> p;
+				p.reserve(prod.size());
+				for (const auto& s : prod)
+					p.push_back(Symbol{ s.isTerminal, s.isTerminal ? terminalMap[s.id] : nonterminalMap[s.id] });
+				copy.rhs.push_back(std::move(p));
+			}
+			out.rules.push_back(std::move(copy));
+		}
+	}
+
+	out.start = top.lhs;
+	out.buildIndex();
+	return out;
+}
+
+// the passes of CNF in the order it runs them
+static const std::vector<std::pair<const char*, std::function<void(Grammar&)>>>& cnfPasses()
+{
+	static const std::vector<std::pair<const char*, std::function<void(Grammar&)>>> passes{
+		{ "addFreshStartSymbol", [](Grammar& g) { g.start = addFreshStartSymbol(g, g.start); } },
+		{ "binarizeRules", [](Grammar& g) { binarizeRules(g); } },
+		{ "removeEpsilonProductions", [](Grammar& g) { removeEpsilonProductions(g, g.start); } },
+		{ "removeUnitProductions", [](Grammar& g) { removeUnitProductions(g, g.start); } },
+		{ "removeUselessSymbols", [](Grammar& g) { removeUselessSymbols(g, g.start); } },
+		{ "eliminateTerminalsFromLong", [](Grammar& g) { eliminateTerminalsFromLong(g); } },
+		{ "mergeEquivalentNonterminals", [](Grammar& g) { mergeEquivalentNonterminals(g, g.start); } },
+		{ "buildIndex", [](Grammar& g) { g.buildIndex(); } },
+	};
+	return passes;
+}
+
+/*
+ * a string of exactly n terminals for the CYK measurements: drawn from the grammar's
+ * language when it has strings of that length, otherwise random terminals (reported
+ * as nonmember, since the chart of a rejected string is usually sparser)
+ */
+static std::vector<SymbolId> cykInput(const Grammar& g, const UniformSampler& us, size_t n, std::mt19937_64& rng, bool& member)
+{
+	std::vector<SymbolId> w;
+	member = sampleUniform(us, n, rng, w);
+	if (member)
+		return w;
+
+	std::vector<SymbolId> alphabet;
+	for (SymbolId t : g.terminals)
+	{
+		if (t != EPSILON_ID)
+			alphabet.push_back(t);
+	}
+	std::sort(alphabet.begin(), alphabet.end());
+	w.clear();
+	if (alphabet.empty())
+		return w;
+	std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+	for (size_t i = 0; i < n; ++i)
+		w.push_back(alphabet[pick(rng)]);
+	return w;
+}
+
+static GenSettings benchSettings()
+{
+	GenSettings cfg;
+	cfg.maxLen = 40;
+	cfg.targetMin = 1;
+	cfg.targetMax = 20;
+	return cfg;
+}
+
+static void benchGrammar(const Grammar& parsed, const std::string& input, size_t scale, const BenchOptions& opts, std::vector<BenchResult>& out)
+{
+	auto record = [&](std::string name, size_t length, const Measurement& m, double items, std::string unit)
+	{
+		BenchResult r;
+		r.name = std::move(name);
+		r.input = input;
+		r.scale = scale;
+		r.length = length;
+		r.m = m;
+		r.itemsPerOp = items;
+		r.unit = std::move(unit);
+		out.push_back(std::move(r));
+	};
+
+	const Grammar source = scaleGrammar(parsed, scale);
+
+	// each pass is timed on copies of the grammar as the previous pass left it
+	Grammar stage = source;
+	for (const auto& [name, pass] : cnfPasses())
+	{
+		const double prods = static_cast<double>(productionCount(stage));
+		record(std::string("cnf/") + name, 0, measureEach(opts.minSeconds, stage, pass), prods, "productions");
+		pass(stage);
+	}
+	record("cnf/CNF", 0, measureEach(opts.minSeconds, source, [](Grammar& g) { CNF(g); }),
+		   static_cast<double>(productionCount(source)), "productions");
+
+	const Grammar& g = stage;
+	const double prods = static_cast<double>(productionCount(g));
+
+	CykIndex idx;
+	record("buildCykIndex", 0, measure(opts.minSeconds, [&]() { idx = buildCykIndex(g); }), prods, "productions");
+	BitCykIndex bits;
+	record("buildBitCykIndex", 0, measure(opts.minSeconds, [&]() { bits = buildBitCykIndex(g, idx); }), prods, "productions");
+
+	const UniformSampler us = buildUniformSampler(g, g.start, CYK_MAX_LENGTH);
+	std::mt19937_64 rng(BENCH_SEED);
+	CykWorkspace ws;
+	for (size_t n = CYK_MIN_LENGTH; n <= CYK_MAX_LENGTH; n *= 2)
+	{
+		bool member = false;
+		const std::vector<SymbolId> w = cykInput(g, us, n, rng, member);
+		if (w.empty())
+			continue;
+		const std::string suffix = member ? "" : "/nonmember";
+		volatile bool sink = false;
+		record("cykAccepts" + suffix, n, measure(opts.minSeconds, [&]() { sink = cykAccepts(g, idx, g.start, w); }),
+			   static_cast<double>(n), "terminals");
+		record("cykAcceptsBits" + suffix, n, measure(opts.minSeconds, [&]() { sink = cykAcceptsBits(g, bits, g.start, w, ws); }),
+			   static_cast<double>(n), "terminals");
+		(void)sink;
+	}
+
+	const GenSettings cfg = benchSettings();
+	const CompiledRuleMap crm = compileRuleMap(buildRuleMap(g));
+	DerivationWorkspace dws;
+	std::mt19937_64 genRng(BENCH_SEED);
+	size_t generated = 0;
+	size_t attempts = 0;
+	const Measurement gen = measure(opts.minSeconds, [&]()
+	{
+		++attempts;
+		if (generateString(crm, g.start, genRng, cfg, dws))
+			++generated;
+	});
+	// throughput counts the strings actually produced, not abandoned derivations
+	record("generateString", 0, gen, attempts ? static_cast<double>(generated) / static_cast<double>(attempts) : 0.0, "strings");
+}
+
+static void benchPair(const Grammar& p1, const Grammar& p2, const std::string& input, size_t scale, const BenchOptions& opts, std::vector<BenchResult>& out)
+{
+	Grammar g1 = scaleGrammar(p1, scale);
+	Grammar g2 = scaleGrammar(p2, scale);
+	CNF(g1);
+	CNF(g2);
+	const CykIndex idx1 = buildCykIndex(g1);
+	const CykIndex idx2 = buildCykIndex(g2);
+	const GenSettings cfg = benchSettings();
+
+	// one search runs until its first witness, so the trial count varies by pair
+	DiffResult last;
+	const Measurement m = measure(opts.minSeconds, [&]()
+	{
+		last = findCounterExample(g1, g1.start, idx1, g2, g2.start, idx2, BENCH_TRIALS, BENCH_SEED, cfg, 1);
+	});
+
+	BenchResult r;
+	r.name = last.found ? "findCounterExample/found" : "findCounterExample";
+	r.input = input;
+	r.scale = scale;
+	r.m = m;
+	r.unit = "searches";
+	out.push_back(std::move(r));
+}
+
+static void printJson(const std::vector<BenchResult>& results, std::ostream& os)
+{
+	auto quoted = [](const std::string& s)
+	{
+		std::string q = "\"";
+		for (char c : s)
+		{
+			if (c == '"' || c == '\\')
+				q += '\\';
+			q += c;
+		}
+		return q + "\"";
+	};
+
+	char buf[64];
+	auto number = [&](double v)
+	{
+		std::snprintf(buf, sizeof buf, "%.6g", v);
+		return std::string(buf);
+	};
+
+	os << "{\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchResult& r = results[i];
+		const double perSecond = r.m.nsPerOp > 0.0 ? r.itemsPerOp * 1e9 / r.m.nsPerOp : 0.0;
+		os << "    {\"name\": " << quoted(r.name)
+		   << ", \"input\": " << quoted(r.input)
+		   << ", \"scale\": " << r.scale;
+		if (r.length)
+			os << ", \"length\": " << r.length;
+		os << ", \"iterations\": " << r.m.iterations
+		   << ", \"ns_per_op\": " << number(r.m.nsPerOp)
+		   << ", \"allocs_per_op\": " << number(r.m.allocsPerOp)
+		   << ", \"throughput\": " << number(perSecond)
+		   << ", \"throughput_unit\": " << quoted(r.unit + "/s") << "}"
+		   << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	os << "  ]\n}\n";
+}
+
+static bool parseFile(const std::string& path, Grammar& g)
+{
+	SourceFile file;
+	if (!file.open(path))
+	{
+		std::cerr << "Error: could not open " << path << std::endl;
+		return false;
+	}
+	try
+	{
+		g = Parser{ file.text() }.parseGrammar();
+	}
+	catch (const SyntaxError& e)
+	{
+		std::cerr << "Error: " << path << ":" << e.line << ":" << e.column << ": " << e.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// the partner of a file named like test3_1.txt is test3_2.txt
+static std::string pairedName(const std::string& path)
+{
+	const std::string tail = "_1.txt";
+	if (path.size() <= tail.size() || path.compare(path.size() - tail.size(), tail.size(), tail) != 0)
+		return "";
+	return path.substr(0, path.size() - tail.size()) + "_2.txt";
+}
+
+static bool parseBenchOptions(int argc, char* argv[], BenchOptions& opts)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (arg == "--min-time" && i + 1 < argc)
+		{
+			opts.minSeconds = std::atof(argv[++i]) / 1000.0;
+		}
+		else if (arg == "--scales" && i + 1 < argc)
+		{
+			opts.scales.clear();
+			std::string list = argv[++i];
+			for (size_t pos = 0; pos <= list.size();)
+			{
+				size_t comma = list.find(',', pos);
+				if (comma == std::string::npos)
+					comma = list.size();
+				const size_t s = std::strtoull(list.substr(pos, comma - pos).c_str(), nullptr, 10);
+				if (s == 0)
+				{
+					std::cerr << "Error: --scales expects positive counts separated by commas" << std::endl;
+					return false;
+				}
+				opts.scales.push_back(s);
+				pos = comma + 1;
+			}
+		}
+		else if (arg.starts_with("--"))
+		{
+			std::cerr << "Error: unknown option " << arg << std::endl;
+			return false;
+		}
+		else
+		{
+			opts.files.push_back(arg);
+		}
+	}
+	return !opts.files.empty();
+}
+
+int main(int argc, char* argv[])
+{
+	BenchOptions opts;
+	if (!parseBenchOptions(argc, argv, opts))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--min-time MS] [--scales 1,10,100] grammar_files...\n";
+		return 1;
+	}
+
+	std::vector<Grammar> grammars(opts.files.size());
+	for (size_t i = 0; i < opts.files.size(); ++i)
+	{
+		if (!parseFile(opts.files[i], grammars[i]))
+			return 1;
+	}
+
+	std::vector<BenchResult> results;
+	for (size_t scale : opts.scales)
+	{
+		for (size_t i = 0; i < opts.files.size(); ++i)
+		{
+			std::cerr << "bench " << opts.files[i] << " x" << scale << "\n";
+			benchGrammar(grammars[i], opts.files[i], scale, opts, results);
+
+			const std::string partner = pairedName(opts.files[i]);
+			for (size_t j = 0; j < opts.files.size(); ++j)
+			{
+				if (!partner.empty() && opts.files[j] == partner)
+					benchPair(grammars[i], grammars[j], opts.files[i] + "," + opts.files[j], scale, opts, results);
+			}
+		}
+	}
+
+	printJson(results, std::cout);
+	return 0;
+}
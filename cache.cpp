@@ -0,0 +1,397 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "cache.h"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * entry layout, all fields native-endian uint32 words:
+ *
+ *   magic, version, source hash (lo, hi), source length (lo, hi)
+ *   terminal count, then the name of every terminal after epsilon
+ *   nonterminal count, then every nonterminal name
+ *   start symbol
+ *   rule count, then per rule: lhs, alternative count, then per alternative
+ *     its length and one word per symbol (top bit set for nonterminals)
+ *   termMap size, then per terminal: count and the producing nonterminals
+ *   binMap size, then per entry: B, C, count and the producing nonterminals
+ *
+ * a name is its byte length followed by its bytes, padded to a whole word. the last
+ * two words are a checksum of everything before them, so a damaged entry is rejected
+ * rather than loaded as a different grammar.
+ */
+static constexpr uint32_t CACHE_MAGIC = 0x43464743;
+static constexpr uint32_t NONTERMINAL_BIT = 0x80000000u;
+
+std::string grammarCacheDir()
+{
+	if (const char* dir = std::getenv("CFG_COMPARATOR_CACHE"); dir && *dir)
+		return dir;
+	if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg)
+		return std::string(xdg) + "/cfg_comparator";
+	if (const char* home = std::getenv("HOME"); home && *home)
+		return std::string(home) + "/.cache/cfg_comparator";
+	return "";
+}
+
+uint64_t hashSource(std::string_view source)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (unsigned char c : source)
+	{
+		h ^= c;
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+static uint64_t checksum(const uint32_t* words, size_t count)
+{
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < count; ++i)
+	{
+		h ^= words[i];
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+static std::string entryPath(const std::string& dir, uint64_t hash)
+{
+	static const char* digits = "0123456789abcdef";
+	std::string name(16, '0');
+	for (int i = 15; i >= 0; --i, hash >>= 4)
+		name[i] = digits[hash & 0xf];
+	return dir + "/" + name + ".cnf";
+}
+
+namespace
+{
+	class Writer
+	{
+	public:
+		void word(uint32_t w)
+		{
+			words.push_back(w);
+		}
+
+		void wide(uint64_t v)
+		{
+			word(static_cast<uint32_t>(v));
+			word(static_cast<uint32_t>(v >> 32));
+		}
+
+		void name(const std::string& s)
+		{
+			word(static_cast<uint32_t>(s.size()));
+			const size_t at = words.size();
+			words.resize(at + (s.size() + 3) / 4, 0);
+			std::memcpy(words.data() + at, s.data(), s.size());
+		}
+
+		void ids(const std::vector<SymbolId>& v)
+		{
+			word(static_cast<uint32_t>(v.size()));
+			words.insert(words.end(), v.begin(), v.end());
+		}
+
+		std::vector<uint32_t> words;
+	};
+
+	/*
+	 * reads words straight out of the mapped file. every read is bounds checked and a
+	 * failed read sticks, so a truncated or corrupted entry is rejected instead of
+	 * being trusted
+	 */
+	class Reader
+	{
+	public:
+		Reader(const uint32_t* data, size_t size) : data(data), size(size) {}
+
+		uint32_t word()
+		{
+			if (pos >= size)
+			{
+				ok = false;
+				return 0;
+			}
+			return data[pos++];
+		}
+
+		uint64_t wide()
+		{
+			uint64_t lo = word();
+			uint64_t hi = word();
+			return lo | (hi << 32);
+		}
+
+		std::string name()
+		{
+			const size_t bytes = word();
+			const size_t count = (bytes + 3) / 4;
+			if (!ok || count > size - pos)
+			{
+				ok = false;
+				return {};
+			}
+			std::string s(reinterpret_cast<const char*>(data + pos), bytes);
+			pos += count;
+			return s;
+		}
+
+		// a count that cannot possibly fit in what is left of the file is damage
+		size_t count()
+		{
+			const size_t n = word();
+			if (n > size - pos)
+				ok = false;
+			return ok ? n : 0;
+		}
+
+		bool ok = true;
+
+	private:
+		const uint32_t* data;
+		size_t size;
+		size_t pos = 0;
+	};
+}
+
+static bool readEntry(Reader& in, std::string_view source, CompiledGrammar& out)
+{
+	if (in.word() != CACHE_MAGIC || in.word() != GRAMMAR_CACHE_VERSION)
+		return false;
+	if (in.wide() != hashSource(source) || in.wide() != source.size())
+		return false;
+
+	Grammar& g = out.grammar;
+
+	// re-interning in id order hands back the same ids
+	const size_t terminals = in.count();
+	for (size_t t = 1; t < terminals && in.ok; ++t)
+		g.symbols.internTerminal(in.name());
+	const size_t nonterminals = in.count();
+	for (size_t A = 0; A < nonterminals && in.ok; ++A)
+		g.symbols.internNonterminal(in.name());
+	if (!in.ok || g.symbols.terminalCount() != std::max<size_t>(terminals, 1) || g.symbols.nonterminalCount() != nonterminals)
+		return false;
+
+	auto symbol = [&](uint32_t w, Symbol& s)
+	{
+		s.isTerminal = (w & NONTERMINAL_BIT) == 0;
+		s.id = w & ~NONTERMINAL_BIT;
+		return s.id < (s.isTerminal ? terminals : nonterminals);
+	};
+	auto nonterminal = [&](uint32_t w) { return w < nonterminals; };
+
+	g.start = in.word();
+	if (!nonterminal(g.start))
+		return false;
+
+	const size_t rules = in.count();
+	g.rules.resize(rules);
+	for (auto& r : g.rules)
+	{
+		r.lhs = in.word();
+		if (!nonterminal(r.lhs))
+			return false;
+
+		r.rhs.resize(in.count());
+		for (auto& prod : r.rhs)
+		{
+			prod.resize(in.count());
+			for (auto& s : prod)
+			{
+				if (!symbol(in.word(), s))
+					return false;
+				if (s.isTerminal)
+					g.terminals.insert(s.id);
+				else
+					g.nonterminals.insert(s.id);
+			}
+		}
+		g.nonterminals.insert(r.lhs);
+		if (!in.ok)
+			return false;
+	}
+	g.terminals.erase(EPSILON_ID);
+
+	auto readIds = [&](std::vector<SymbolId>& v)
+	{
+		v.resize(in.count());
+		for (auto& A : v)
+		{
+			A = in.word();
+			if (!nonterminal(A))
+				return false;
+		}
+		return in.ok;
+	};
+
+	out.index.termMap.resize(in.count());
+	for (auto& v : out.index.termMap)
+	{
+		if (!readIds(v))
+			return false;
+	}
+
+	const size_t pairs = in.count();
+	out.index.binMap.reserve(pairs);
+	for (size_t i = 0; i < pairs; ++i)
+	{
+		const SymbolId B = in.word();
+		const SymbolId C = in.word();
+		if (!readIds(out.index.binMap[{ B, C }]))
+			return false;
+	}
+
+	if (!in.ok)
+		return false;
+
+	g.buildIndex();
+	return true;
+}
+
+bool loadCompiledGrammar(const std::string& dir, std::string_view source, CompiledGrammar& out)
+{
+	if (dir.empty())
+		return false;
+
+	const std::string path = entryPath(dir, hashSource(source));
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size % 4 != 0)
+	{
+		::close(fd);
+		return false;
+	}
+
+	const size_t bytes = static_cast<size_t>(st.st_size);
+	void* map = ::mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	const uint32_t* words = static_cast<const uint32_t*>(map);
+	const size_t count = bytes / 4;
+
+	CompiledGrammar cg;
+	bool ok = false;
+	if (count > 2)
+	{
+		const uint64_t stored = words[count - 2] | (static_cast<uint64_t>(words[count - 1]) << 32);
+		if (stored == checksum(words, count - 2))
+		{
+			Reader in(words, count - 2);
+			ok = readEntry(in, source, cg);
+		}
+	}
+	::munmap(map, bytes);
+
+	if (ok)
+		out = std::move(cg);
+	return ok;
+}
+
+bool storeCompiledGrammar(const std::string& dir, std::string_view source, const CompiledGrammar& cg)
+{
+	if (dir.empty())
+		return false;
+
+	const Grammar& g = cg.grammar;
+	Writer out;
+
+	out.word(CACHE_MAGIC);
+	out.word(GRAMMAR_CACHE_VERSION);
+	out.wide(hashSource(source));
+	out.wide(source.size());
+
+	out.word(static_cast<uint32_t>(g.symbols.terminalCount()));
+	for (SymbolId t = 1; t < g.symbols.terminalCount(); ++t)
+		out.name(g.symbols.terminalName(t));
+	out.word(static_cast<uint32_t>(g.symbols.nonterminalCount()));
+	for (SymbolId A = 0; A < g.symbols.nonterminalCount(); ++A)
+		out.name(g.symbols.nonterminalName(A));
+
+	out.word(g.start);
+	out.word(static_cast<uint32_t>(g.rules.size()));
+	for (const auto& r : g.rules)
+	{
+		out.word(r.lhs);
+		out.word(static_cast<uint32_t>(r.rhs.size()));
+		for (const auto& prod : r.rhs)
+		{
+			out.word(static_cast<uint32_t>(prod.size()));
+			for (const auto& s : prod)
+				out.word(s.isTerminal ? s.id : (s.id | NONTERMINAL_BIT));
+		}
+	}
+
+	out.word(static_cast<uint32_t>(cg.index.termMap.size()));
+	for (const auto& v : cg.index.termMap)
+		out.ids(v);
+
+	out.word(static_cast<uint32_t>(cg.index.binMap.size()));
+	for (const auto& [bc, lhs] : cg.index.binMap)
+	{
+		out.word(bc.first);
+		out.word(bc.second);
+		out.ids(lhs);
+	}
+
+	out.wide(checksum(out.words.data(), out.words.size()));
+
+	// write beside the entry and rename over it, so a reader never maps a half-written file
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+	if (ec)
+		return false;
+
+	const std::string path = entryPath(dir, hashSource(source));
+	const std::string temp = path + ".tmp" + std::to_string(::getpid());
+	{
+		std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+		file.write(reinterpret_cast<const char*>(out.words.data()),
+				   static_cast<std::streamsize>(out.words.size() * sizeof(uint32_t)));
+		if (!file)
+		{
+			std::filesystem::remove(temp, ec);
+			return false;
+		}
+	}
+
+	std::filesystem::rename(temp, path, ec);
+	if (ec)
+	{
+		std::filesystem::remove(temp, ec);
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,56 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __CACHE_H__
+#define __CACHE_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "grammar.h"
+#include "cyk.h"
+
+/*
+ * a grammar after CNF together with its CYK index, which is everything the
+ * comparison modes need from a grammar file
+ */
+struct CompiledGrammar
+{
+	Grammar grammar;
+	CykIndex index;
+};
+
+// bump whenever the file layout or the output of CNF changes, so stale entries are rebuilt
+constexpr uint32_t GRAMMAR_CACHE_VERSION = 1;
+
+// $CFG_COMPARATOR_CACHE, else $XDG_CACHE_HOME/cfg_comparator, else ~/.cache/cfg_comparator.
+// empty when none of them is set
+std::string grammarCacheDir();
+
+// 64-bit FNV-1a of the grammar source, the cache key
+uint64_t hashSource(std::string_view source);
+
+/*
+ * the cache is best effort: load returns false on a missing, stale or damaged entry
+ * and store returns false when the entry could not be written, and either way the
+ * caller simply compiles the grammar itself
+ */
+bool loadCompiledGrammar(const std::string& dir, std::string_view source, CompiledGrammar& out);
+bool storeCompiledGrammar(const std::string& dir, std::string_view source, const CompiledGrammar& cg);
+
+#endif
@@ -0,0 +1,839 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cnf.h"
+#include "analysis.h"
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+
+bool isUnitProduction(const std::vector<Symbol>& prod)
+{
+	return prod.size() == 1 && !prod[0].isTerminal;
+}
+
+bool isEpsilonProduction(const std::vector<Symbol>& prod)
+{
+	return prod.size() == 1 && prod[0].isTerminal && prod[0].id == EPSILON_ID;
+}
+
+bool isEpsilonSymbol(const Symbol& s)
+{
+	return s.isTerminal && s.id == EPSILON_ID;
+}
+
+const std::string& symbolName(const Grammar& g, const Symbol& s)
+{
+	return s.isTerminal ? g.symbols.terminalName(s.id) : g.symbols.nonterminalName(s.id);
+}
+
+void rebuildSymbolSets(Grammar& g)
+{
+	g.terminals.clear();
+	g.nonterminals.clear();
+
+	for (const auto& rule : g.rules)
+	{
+		g.nonterminals.insert(rule.lhs);
+
+		for (const auto& prod : rule.rhs)
+		{
+			for (const auto& symbol : prod)
+			{
+				if (symbol.isTerminal)
+				{
+					if (symbol.id != EPSILON_ID)
+						g.terminals.insert(symbol.id);
+				}
+				else
+					g.nonterminals.insert(symbol.id);
+			}
+		}
+	}
+}
+
+
+/*
+ * Tarjan's strongly connected components over the unit graph (A -> B for every
+ * unit production A -> B), with an explicit call stack so long unit chains cannot
+ * overflow the real one. components are numbered in the order they complete,
+ * which is sinks first: every component a component can reach has a smaller number.
+ */
+std::vector<uint32_t> unitComponents(const std::vector<std::vector<SymbolId>>& succ, size_t& count)
+{
+	constexpr uint32_t UNVISITED = UINT32_MAX;
+	const size_t n = succ.size();
+
+	std::vector<uint32_t> index(n, UNVISITED), low(n, 0), comp(n, UNVISITED);
+	std::vector<bool> onStack(n, false);
+	std::vector<SymbolId> stack;
+	std::vector<std::pair<SymbolId, size_t>> calls; // node and its next edge
+	uint32_t next = 0;
+	count = 0;
+
+	auto visit = [&](SymbolId v)
+	{
+		index[v] = low[v] = next++;
+		stack.push_back(v);
+		onStack[v] = true;
+		calls.push_back({ v, 0 });
+	};
+
+	for (SymbolId root = 0; root < n; ++root)
+	{
+		if (index[root] != UNVISITED)
+			continue;
+
+		visit(root);
+		while (!calls.empty())
+		{
+			const SymbolId v = calls.back().first;
+			size_t& e = calls.back().second;
+
+			if (e < succ[v].size())
+			{
+				const SymbolId w = succ[v][e++];
+				if (index[w] == UNVISITED)
+					visit(w);
+				else if (onStack[w])
+					low[v] = std::min(low[v], index[w]);
+				continue;
+			}
+
+			if (low[v] == index[v])
+			{
+				SymbolId x;
+				do
+				{
+					x = stack.back();
+					stack.pop_back();
+					onStack[x] = false;
+					comp[x] = static_cast<uint32_t>(count);
+				} while (x != v);
+				++count;
+			}
+
+			calls.pop_back();
+			if (!calls.empty())
+				low[calls.back().first] = std::min(low[calls.back().first], low[v]);
+		}
+	}
+
+	return comp;
+}
+
+/*
+ * nonterminals in one unit cycle derive each other, so each component of the unit
+ * graph is merged into a single nonterminal (the start symbol if it is a member,
+ * otherwise the member whose rule comes first). the non-unit productions of a
+ * component are then its own plus those of every component it reaches, computed
+ * once per component sinks first instead of by a separate search per nonterminal.
+ * rules sharing a lhs are merged into one rule along the way.
+ */
+void removeUnitProductions(Grammar& g, SymbolId startSymbol)
+{
+	g.buildIndex();
+	const size_t nts = g.symbols.nonterminalCount();
+
+	std::vector<std::vector<SymbolId>> succ(nts);
+	std::vector<SymbolId> lhsOrder;
+	std::vector<bool> isLhs(nts, false);
+
+	for (uint32_t p = 0; p < g.productions.size(); ++p)
+	{
+		const SymbolId A = g.prodLhs[p];
+		if (!isLhs[A])
+		{
+			isLhs[A] = true;
+			lhsOrder.push_back(A);
+		}
+
+		const auto& prod = g.production(p);
+		if (isUnitProduction(prod))
+			succ[A].push_back(prod[0].id);
+	}
+
+	size_t count = 0;
+	const std::vector<uint32_t> comp = unitComponents(succ, count);
+
+	// members of each component, lhs order first so the representative leads
+	std::vector<SymbolId> rep(count, NO_SYMBOL);
+	std::vector<std::vector<SymbolId>> members(count);
+	for (SymbolId A : lhsOrder)
+	{
+		members[comp[A]].push_back(A);
+		if (rep[comp[A]] == NO_SYMBOL)
+			rep[comp[A]] = A;
+	}
+	for (SymbolId A = 0; A < nts; ++A)
+	{
+		if (!isLhs[A])
+			members[comp[A]].push_back(A);
+		if (rep[comp[A]] == NO_SYMBOL)
+			rep[comp[A]] = A;
+	}
+	if (startSymbol < nts)
+		rep[comp[startSymbol]] = startSymbol;
+
+	std::vector<std::vector<std::vector<Symbol>>> closure(count);
+	std::vector<size_t> mergedInto(count, SIZE_MAX);
+
+	for (size_t c = 0; c < count; ++c)
+	{
+		std::unordered_set<std::vector<Symbol>, ProdHash> seenAlt;
+		auto& out = closure[c];
+
+		for (SymbolId A : members[c])
+		{
+			for (uint32_t p : g.byLhs[A])
+			{
+				const auto& prod = g.production(p);
+				if (isUnitProduction(prod))
+					continue;
+
+				std::vector<Symbol> renamed = prod;
+				for (auto& sym : renamed)
+				{
+					if (!sym.isTerminal)
+						sym.id = rep[comp[sym.id]];
+				}
+
+				if (seenAlt.insert(renamed).second)
+					out.push_back(std::move(renamed));
+			}
+		}
+
+		// successors completed earlier, so their closures are final
+		for (SymbolId A : members[c])
+		{
+			for (SymbolId B : succ[A])
+			{
+				const size_t d = comp[B];
+				if (d == c || mergedInto[d] == c)
+					continue;
+				mergedInto[d] = c;
+
+				for (const auto& prod : closure[d])
+				{
+					if (seenAlt.insert(prod).second)
+						out.push_back(prod);
+				}
+			}
+		}
+	}
+
+	std::vector<Rule> newRules;
+	for (SymbolId A : lhsOrder)
+	{
+		if (rep[comp[A]] != A)
+			continue;
+
+		Rule r;
+		r.lhs = A;
+		r.rhs = std::move(closure[comp[A]]);
+		newRules.push_back(std::move(r));
+	}
+
+	g.rules = std::move(newRules);
+}
+
+SymbolId addFreshStartSymbol(Grammar& g, SymbolId oldStart)
+{
+	auto freshStartName = [](const Grammar& g, const std::string& base = "S0") -> std::string
+	{
+		if (g.symbols.findNonterminal(base) == NO_SYMBOL)
+			return base;
+		for (int i = 1; ; ++i)
+		{
+			std::string candidate = base + "_" + std::to_string(i);
+			if (g.symbols.findNonterminal(candidate) == NO_SYMBOL)
+				return candidate; 
+		}
+	};
+
+	SymbolId newStart = g.symbols.internNonterminal(freshStartName(g, "S0"));
+	
+	Rule r;
+	
+	r.lhs = newStart;
+
+	Symbol s;
+	s.isTerminal = false;
+	s.id = oldStart;
+
+	r.rhs.push_back(std::vector<Symbol>{s});
+	g.rules.insert(g.rules.begin(), r);
+	g.nonterminals.insert(newStart);
+
+	return newStart;
+}
+
+bool startDerivesEpsilon(const std::vector<bool>& nullable, SymbolId startSymbol)
+{
+	return startSymbol < nullable.size() && nullable[startSymbol];
+}
+
+void removeEpsilonProductions(Grammar& g, SymbolId startSymbol)
+{
+	// calculate the nullable set
+	g.buildIndex();
+	std::vector<bool> nullable = nullableSet(g);
+	bool keepStartEpsilon = startDerivesEpsilon(nullable, startSymbol);
+
+	for (auto& rule : g.rules)
+	{
+		// declare a set to build the new alts
+		std::vector<std::vector<Symbol>> newAlts;
+		std::unordered_set<std::vector<Symbol>, ProdHash> seen; // keep track of what's already been seen
+
+		for (auto& prod : rule.rhs)
+		{
+			// skip explicit epsilon productions for now
+			if (isEpsilonProduction(prod))
+				continue;
+			
+			// epsilon should not appear mixed with other symbols in the production
+			for (auto& symbol : prod)
+			{
+				if (isEpsilonSymbol(symbol))
+				{
+					std::cerr << "Epsilon symbol appeard in non-epsilon production" << std::endl;
+					exit(1);
+				}
+			}
+
+			// expand left to right: every nullable nonterminal doubles the variants built so far
+			// (kept and dropped). CNF binarizes first, so a production has at most two
+			// symbols here and at most four variants, which keeps the output linear
+			std::vector<std::vector<Symbol>> variants(1);
+			for (const auto& symbol : prod)
+			{
+				const bool canDrop = !symbol.isTerminal && nullable[symbol.id];
+				const size_t count = variants.size();
+				for (size_t v = 0; v < count; ++v)
+				{
+					if (canDrop)
+						variants.push_back(variants[v]);
+					variants[v].push_back(symbol);
+				}
+			}
+
+			for (auto& candidate : variants)
+			{
+				// if we delete everything, this is epsilon
+				if (candidate.empty())
+				{
+					if (keepStartEpsilon && rule.lhs == startSymbol)
+					{
+						std::vector<Symbol> eps{Symbol{true, EPSILON_ID}};
+						if (seen.insert(eps).second)
+							newAlts.push_back(eps);
+					}
+					continue;
+				}
+				
+				if (seen.insert(candidate).second)
+					newAlts.push_back(std::move(candidate));
+			}
+		}
+
+		// if rule is start symbol, keep epsilon
+		if (keepStartEpsilon && rule.lhs == startSymbol)
+		{
+			std::vector<Symbol> eps{Symbol{true, EPSILON_ID}};
+			if (seen.insert(eps).second)
+				newAlts.push_back(eps);
+		}
+
+		// replace rhs with newAlts
+		rule.rhs = std::move(newAlts);
+	} 
+}
+
+
+
+/*
+ * a symbol is useful if it generates some string and is reachable from the start
+ * symbol through productions of generating symbols. both sets come from one index,
+ * so the grammar is filtered once
+ */
+void removeUselessSymbols(Grammar& g, SymbolId startSymbol)
+{
+	g.buildIndex();
+	const std::vector<bool> GEN = generatingSet(g);
+	const std::vector<bool> REACH = reachableSet(g, startSymbol, GEN);
+
+	std::vector<Rule> newRules;
+	for (const Rule& r : g.rules)
+	{
+		if (!REACH[r.lhs])
+			continue;
+
+		Rule nr;
+		nr.lhs = r.lhs;
+
+		for (const auto& prod : r.rhs)
+		{
+			bool ok = true;
+			for (const Symbol& s : prod)
+			{
+				if (!s.isTerminal && !GEN[s.id])
+				{
+					ok = false;
+					break;
+				}
+			}
+			if (ok)
+				nr.rhs.push_back(prod);
+		}
+
+		if (!nr.rhs.empty())
+			newRules.push_back(std::move(nr));
+	}
+
+	g.rules = std::move(newRules);
+	rebuildSymbolSets(g);
+}
+
+void printSymbols(const Grammar& g)
+{
+	std::cout << "Nonterminals:\n";
+	for (SymbolId nt : g.nonterminals)
+		std::cout << " " << g.symbols.nonterminalName(nt) << "\n";
+
+	std::cout << "Terminals:\n";
+	for (SymbolId t : g.terminals)
+		std::cout << " " << g.symbols.terminalName(t) << "\n";
+}
+
+// next is where the search for a free base_i suffix resumes, so a pass that makes many
+// helpers from one base probes each suffix once instead of rescanning from 1 every time
+SymbolId makeFreshNonterminal(Grammar& g, const std::string& base, int& next)
+{
+	if (next == 1 && g.symbols.findNonterminal(base) == NO_SYMBOL)
+		return g.symbols.internNonterminal(base);
+
+	for (int& i = next; ; ++i)
+	{
+		std::string cand = base + "_" + std::to_string(i);
+		if (g.symbols.findNonterminal(cand) == NO_SYMBOL)
+			return g.symbols.internNonterminal(cand);
+	}
+}
+
+SymbolId makeFreshNonterminal(Grammar& g, const std::string& base)
+{
+	int next = 1;
+	return makeFreshNonterminal(g, base, next);
+}
+
+std::string sanitize(const std::string& t)
+{
+	std::string out;
+	for (unsigned char c : t)
+	{
+		if (std::isalnum(c))
+			out.push_back((char)c);
+		else
+			out.push_back('_');
+	}
+
+	if (out.empty())
+		out = "tok";
+	return out;
+}
+
+
+void eliminateTerminalsFromLong(Grammar& g)
+{
+	std::vector<SymbolId> termToNT(g.symbols.terminalCount(), NO_SYMBOL);
+
+	std::vector<Rule> newRules;
+
+	for (auto& r : g.rules)
+	{
+		for (auto& prod : r.rhs)
+		{
+			if (isEpsilonProduction(prod))
+				continue;
+
+			if (prod.size() < 2)
+				continue;
+
+			for (auto& symbol : prod)
+			{
+				if (!symbol.isTerminal)
+					continue;
+
+				if (isEpsilonSymbol(symbol))
+				{
+					std::cerr << "epsilon appears in a long RHS production" << std::endl;
+					exit(1);
+				}
+
+				if (termToNT[symbol.id] == NO_SYMBOL)
+				{
+					std::string base = "T_" + sanitize(g.symbols.terminalName(symbol.id));
+					SymbolId helper = makeFreshNonterminal(g, base);
+					termToNT[symbol.id] = helper;
+
+
+					Rule tr;
+					tr.lhs = helper;
+					Symbol termSym;
+					termSym.isTerminal = true;
+					termSym.id = symbol.id;
+
+					tr.rhs.push_back(std::vector<Symbol>{ termSym });
+					newRules.push_back(tr);
+
+					g.nonterminals.insert(helper);
+				}
+
+				symbol.isTerminal = false;
+				symbol.id = termToNT[symbol.id];
+			}
+		}
+	}
+
+	for (auto& nr : newRules)
+		g.rules.push_back(std::move(nr));
+
+	rebuildSymbolSets(g);
+}
+
+
+void binarizeRules(Grammar& g)
+{
+	std::vector<Rule> extraRules;
+	extraRules.reserve(64);
+
+	// helpers are hash-consed on (first symbol, rest of the suffix), so every production
+	// ending in the same symbols shares one chain of X helpers instead of growing its own
+	std::unordered_map<std::vector<Symbol>, SymbolId, ProdHash> helperFor;
+	int nextHelper = 1;
+
+	for (auto& r : g.rules)
+	{
+		std::vector<std::vector<Symbol>> newRhs;
+		newRhs.reserve(r.rhs.size());
+
+		for (const auto& prod : r.rhs)
+		{
+			if (prod.size() <= 2)
+			{
+				newRhs.push_back(prod);
+				continue;
+			}
+
+			// build the suffix chain from the back: X_i -> prod[i] X_(i+1), last one -> two symbols
+			Symbol rest = prod.back();
+			for (size_t i = prod.size() - 2; i >= 1; --i)
+			{
+				std::vector<Symbol> body{ prod[i], rest };
+				auto it = helperFor.find(body);
+				if (it == helperFor.end())
+				{
+					SymbolId helper = makeFreshNonterminal(g, "X", nextHelper);
+					g.nonterminals.insert(helper);
+
+					Rule rr;
+					rr.lhs = helper;
+					rr.rhs.push_back(body);
+					extraRules.push_back(std::move(rr));
+
+					it = helperFor.emplace(std::move(body), helper).first;
+				}
+
+				rest = Symbol{ false, it->second };
+			}
+
+			newRhs.push_back(std::vector<Symbol>{ prod[0], rest });
+		}
+
+		r.rhs = std::move(newRhs);
+	}
+
+	for (auto& rr : extraRules)
+	{
+		g.rules.push_back(std::move(rr));
+	}
+
+	rebuildSymbolSets(g);
+}
+
+/*
+ * merge nonterminals that derive the same strings for structural reasons. two
+ * nonterminals share a block while their productions, read through the current
+ * blocks, form the same set. starting from one block and splitting until nothing
+ * changes gives the coarsest such partition, so besides identical rules (duplicate
+ * T_ helpers, equal X chains) it also merges recursive twins like A -> a A | b and
+ * B -> a B | b. the start symbol names its own block, every other block is named
+ * by its first lhs in rule order.
+ */
+void mergeEquivalentNonterminals(Grammar& g, SymbolId startSymbol)
+{
+	constexpr uint32_t NONTERMINAL_TAG = 0x80000000u;
+
+	g.buildIndex();
+	const size_t nts = g.symbols.nonterminalCount();
+
+	// productions of A read through the current blocks, sorted and flattened
+	std::vector<uint32_t> block(nts, 0);
+	auto signature = [&](SymbolId A)
+	{
+		std::vector<std::vector<SymbolId>> prods;
+		prods.reserve(g.byLhs[A].size());
+		for (uint32_t pi : g.byLhs[A])
+		{
+			const auto& prod = g.production(pi);
+			std::vector<SymbolId> p;
+			p.reserve(prod.size());
+			for (const auto& s : prod)
+				p.push_back(s.isTerminal ? s.id : (NONTERMINAL_TAG | block[s.id]));
+			prods.push_back(std::move(p));
+		}
+		std::sort(prods.begin(), prods.end());
+		prods.erase(std::unique(prods.begin(), prods.end()), prods.end());
+
+		std::vector<SymbolId> sig;
+		for (const auto& p : prods)
+		{
+			sig.push_back(static_cast<SymbolId>(p.size()));
+			sig.insert(sig.end(), p.begin(), p.end());
+		}
+		return sig;
+	};
+
+	/*
+	 * each round only recomputes the signatures of dirty nonterminals, the ones with a
+	 * successor that changed block last round; everyone else's signature still equals
+	 * the one their block was formed with (blockSig). when a block splits, the part
+	 * holding its clean members, or else its largest part, keeps the id, so only the
+	 * nonterminals that split off get a new block and dirty their users. a long X chain
+	 * then costs one small round per link instead of a pass over the whole grammar.
+	 */
+	std::vector<size_t> blockSize{ 0 };
+	std::vector<std::vector<SymbolId>> blockSig{ {} };
+	std::vector<SymbolId> dirty;
+	std::vector<bool> isDirty(nts, false);
+	for (const auto& r : g.rules)
+	{
+		if (!isDirty[r.lhs])
+		{
+			isDirty[r.lhs] = true;
+			dirty.push_back(r.lhs);
+			++blockSize[0];
+		}
+	}
+
+	while (!dirty.empty())
+	{
+		std::sort(dirty.begin(), dirty.end());
+
+		// every signature is taken before anything moves this round
+		std::vector<std::vector<SymbolId>> sigs;
+		sigs.reserve(dirty.size());
+		for (SymbolId A : dirty)
+			sigs.push_back(signature(A));
+
+		// blocks that keep some clean members, decided before any sizes change
+		std::unordered_map<uint32_t, size_t> dirtyIn;
+		for (SymbolId A : dirty)
+			++dirtyIn[block[A]];
+		std::unordered_set<uint32_t> hasClean;
+		for (const auto& [b, count] : dirtyIn)
+		{
+			if (count < blockSize[b])
+				hasClean.insert(b);
+		}
+
+		// group the dirty nonterminals by (block, signature)
+		std::unordered_map<std::vector<SymbolId>, size_t, WordHash> groupIds;
+		std::vector<size_t> groupOf(dirty.size());
+		std::vector<size_t> groupFirst, groupCount;
+		for (size_t i = 0; i < dirty.size(); ++i)
+		{
+			std::vector<SymbolId> key{ block[dirty[i]] };
+			key.insert(key.end(), sigs[i].begin(), sigs[i].end());
+
+			auto [it, fresh] = groupIds.emplace(std::move(key), groupFirst.size());
+			if (fresh)
+			{
+				groupFirst.push_back(i);
+				groupCount.push_back(0);
+			}
+			groupOf[i] = it->second;
+			++groupCount[it->second];
+		}
+
+		// per block, the group that keeps its id: the one matching the clean members,
+		// or with none the largest, so the fewest nonterminals move
+		std::unordered_map<uint32_t, size_t> keeper;
+		for (size_t gi = 0; gi < groupFirst.size(); ++gi)
+		{
+			const size_t first = groupFirst[gi];
+			const uint32_t b = block[dirty[first]];
+			if (hasClean.count(b))
+			{
+				if (sigs[first] == blockSig[b])
+					keeper[b] = gi;
+				continue;
+			}
+
+			auto it = keeper.find(b);
+			if (it == keeper.end() || groupCount[gi] > groupCount[it->second])
+				keeper[b] = gi;
+		}
+
+		std::vector<uint32_t> groupBlock(groupFirst.size());
+		for (size_t gi = 0; gi < groupFirst.size(); ++gi)
+		{
+			const size_t first = groupFirst[gi];
+			const uint32_t b = block[dirty[first]];
+			auto it = keeper.find(b);
+			if (it != keeper.end() && it->second == gi)
+			{
+				groupBlock[gi] = b;
+				blockSig[b] = sigs[first];
+			}
+			else
+			{
+				groupBlock[gi] = static_cast<uint32_t>(blockSize.size());
+				blockSize.push_back(0);
+				blockSig.push_back(sigs[first]);
+			}
+		}
+
+		std::vector<SymbolId> moved;
+		for (size_t i = 0; i < dirty.size(); ++i)
+		{
+			const SymbolId A = dirty[i];
+			const uint32_t to = groupBlock[groupOf[i]];
+			if (to != block[A])
+			{
+				--blockSize[block[A]];
+				++blockSize[to];
+				block[A] = to;
+				moved.push_back(A);
+			}
+		}
+
+		for (SymbolId A : dirty)
+			isDirty[A] = false;
+		dirty.clear();
+
+		for (SymbolId A : moved)
+		{
+			for (uint32_t p : g.uses[A])
+			{
+				const SymbolId U = g.prodLhs[p];
+				if (!isDirty[U])
+				{
+					isDirty[U] = true;
+					dirty.push_back(U);
+				}
+			}
+		}
+	}
+
+	const size_t blocks = blockSize.size();
+	std::vector<SymbolId> rep(blocks, NO_SYMBOL);
+	for (const auto& r : g.rules)
+	{
+		if (r.lhs == startSymbol)
+			rep[block[r.lhs]] = r.lhs;
+	}
+	for (const auto& r : g.rules)
+	{
+		if (rep[block[r.lhs]] == NO_SYMBOL)
+			rep[block[r.lhs]] = r.lhs;
+	}
+
+	std::vector<Rule> newRules;
+	for (auto& r : g.rules)
+	{
+		if (rep[block[r.lhs]] != r.lhs)
+			continue;
+
+		std::unordered_set<std::vector<Symbol>, ProdHash> seen;
+		Rule nr;
+		nr.lhs = r.lhs;
+
+		for (auto& prod : r.rhs)
+		{
+			for (auto& s : prod)
+			{
+				if (!s.isTerminal)
+					s.id = rep[block[s.id]];
+			}
+			if (seen.insert(prod).second)
+				nr.rhs.push_back(std::move(prod));
+		}
+
+		newRules.push_back(std::move(nr));
+	}
+
+	g.rules = std::move(newRules);
+	rebuildSymbolSets(g);
+}
+
+// function to convert a grammar to chomsky normal form
+Grammar CNF(Grammar& g) 
+{
+	g.start = addFreshStartSymbol(g, g.start);
+
+	// binarizing first keeps every production at two symbols or fewer, so removing
+	// epsilon productions adds at most three variants per production instead of 2^m
+	binarizeRules(g);
+
+	removeEpsilonProductions(g, g.start);
+	removeUnitProductions(g, g.start);
+	removeUselessSymbols(g, g.start);
+
+	eliminateTerminalsFromLong(g);
+	mergeEquivalentNonterminals(g, g.start);
+
+	g.buildIndex();
+	return g;
+}
+
+
+void printGrammar(const Grammar& g)
+{
+	for (const auto& rule : g.rules)
+	{
+		std::cout << g.symbols.nonterminalName(rule.lhs) << " -> ";
+
+		for (size_t i = 0; i < rule.rhs.size(); ++i)
+		{
+			for (const auto& symbol : rule.rhs[i])
+			{
+				if (symbol.isTerminal && symbol.id != EPSILON_ID)
+					std::cout << "\"" << symbolName(g, symbol) << "\" ";
+				else
+					std::cout << symbolName(g, symbol) << " ";
+			}
+			if (i != rule.rhs.size() - 1)
+				std::cout << "| ";
+			else
+				std::cout << ";\n";
+		}
+	}
+}
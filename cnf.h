@@ -0,0 +1,50 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __CNF_H__
+#define __CNF_H__
+
+#include <string>
+#include <vector>
+#include "grammar.h"
+#include "cyk.h"
+
+/*
+ * conversion to Chomsky normal form. CNF runs the passes below in order; they are
+ * exposed one by one so they can be timed and tested on their own
+ */
+
+bool isUnitProduction(const std::vector<Symbol>& prod);
+bool isEpsilonProduction(const std::vector<Symbol>& prod);
+bool isEpsilonSymbol(const Symbol& s);
+
+void rebuildSymbolSets(Grammar& g);
+
+SymbolId addFreshStartSymbol(Grammar& g, SymbolId oldStart);
+void binarizeRules(Grammar& g);
+void removeEpsilonProductions(Grammar& g, SymbolId startSymbol);
+void removeUnitProductions(Grammar& g, SymbolId startSymbol);
+void removeUselessSymbols(Grammar& g, SymbolId startSymbol);
+void eliminateTerminalsFromLong(Grammar& g);
+void mergeEquivalentNonterminals(Grammar& g, SymbolId startSymbol);
+
+// function to convert a grammar to chomsky normal form
+Grammar CNF(Grammar& g);
+
+void printGrammar(const Grammar& g);
+
+#endif
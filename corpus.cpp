@@ -0,0 +1,231 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "corpus.h"
+#include "stats.h"
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace
+{
+    /*
+     * splits corpus lines into the terminal ids of one grammar, NO_SYMBOL for tokens the
+     * grammar has never seen. in Chars mode every byte's id is looked up once up front,
+     * so a line is tokenized without hashing or allocating
+     */
+    class LineTokenizer
+    {
+    public:
+        LineTokenizer(Tokenizer kind, const SymbolTable& symbols)
+        : kind(kind), symbols(&symbols)
+        {
+            if (kind == Tokenizer::Chars)
+            {
+                for (size_t c = 0; c < 256; ++c)
+                {
+                    const char ch = static_cast<char>(c);
+                    byteIds[c] = symbols.findTerminal(std::string_view(&ch, 1));
+                }
+            }
+        }
+
+        void split(std::string_view line, std::vector<SymbolId>& out) const
+        {
+            out.clear();
+
+            if (kind == Tokenizer::Chars)
+            {
+                for (unsigned char c : line)
+                    out.push_back(byteIds[c]);
+                return;
+            }
+
+            auto isSpace = [](char c) { return c == ' ' || c == '\t' || c == '\v' || c == '\f'; };
+
+            size_t i = 0;
+            while (i < line.size())
+            {
+                while (i < line.size() && isSpace(line[i]))
+                    ++i;
+                const size_t start = i;
+                while (i < line.size() && !isSpace(line[i]))
+                    ++i;
+                if (i > start)
+                    out.push_back(symbols->findTerminal(line.substr(start, i - start)));
+            }
+        }
+
+    private:
+        Tokenizer kind;
+        const SymbolTable* symbols;
+        SymbolId byteIds[256] = {};
+    };
+}
+
+CorpusStats checkCorpus(
+    std::istream& in,
+    const std::vector<const Grammar*>& grammars,
+    const std::vector<const CykIndex*>& indexes,
+    Tokenizer tokenizer,
+    size_t threads,
+    size_t batchLines,
+    std::ostream& out)
+{
+    CorpusStats stats;
+    const auto begin = std::chrono::steady_clock::now();
+
+    const size_t count = grammars.size();
+    threads = std::max<size_t>(threads, 1);
+    batchLines = std::max<size_t>(batchLines, 1);
+
+    std::vector<BitCykIndex> bits;
+    std::vector<LineTokenizer> tokenizers;
+    for (size_t g = 0; g < count; ++g)
+    {
+        bits.push_back(buildBitCykIndex(*grammars[g], *indexes[g]));
+        tokenizers.emplace_back(tokenizer, grammars[g]->symbols);
+    }
+
+    // per worker scratch, kept across batches
+    std::vector<CykWorkspace> workspaces(threads);
+    std::vector<std::vector<SymbolId>> words(threads);
+
+    std::vector<std::string> batch(batchLines);
+    std::vector<uint8_t> verdicts(batchLines * count);
+
+    auto checkLines = [&](size_t k, size_t lines)
+    {
+        for (size_t i = k; i < lines; i += threads)
+        {
+            for (size_t g = 0; g < count; ++g)
+            {
+                tokenizers[g].split(batch[i], words[k]);
+                verdicts[i * count + g] = cykAcceptsBits(*grammars[g], bits[g], grammars[g]->start, words[k], workspaces[k]);
+            }
+        }
+    };
+
+    /*
+     * workers 1 .. threads - 1 live for the whole run, the reading thread is worker 0.
+     * each batch bumps the generation under the lock; a worker that sees a new one
+     * checks its share of the lines, and the last to finish wakes the reader
+     */
+    std::mutex lock;
+    std::condition_variable wake;
+    size_t generation = 0;
+    size_t filled = 0;
+    size_t busy = 0;
+    bool finished = false;
+
+    auto runWorker = [&](size_t k)
+    {
+        StatsScope stats;
+        size_t seen = 0;
+        for (;;)
+        {
+            size_t lines = 0;
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                wake.wait(guard, [&]() { return generation != seen || finished; });
+                if (generation == seen)
+                    return;
+                seen = generation;
+                lines = filled;
+            }
+
+            checkLines(k, lines);
+
+            std::lock_guard<std::mutex> guard(lock);
+            if (--busy == 0)
+                wake.notify_all();
+        }
+    };
+
+    std::vector<std::jthread> pool;
+    pool.reserve(threads - 1);
+    for (size_t k = 1; k < threads; ++k)
+        pool.emplace_back(runWorker, k);
+
+    while (in)
+    {
+        size_t lines = 0;
+        while (lines < batchLines && std::getline(in, batch[lines]))
+        {
+            // tolerate CRLF corpora
+            if (!batch[lines].empty() && batch[lines].back() == '\r')
+                batch[lines].pop_back();
+            ++lines;
+        }
+        if (lines == 0)
+            break;
+
+        if (threads > 1)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            filled = lines;
+            busy = threads - 1;
+            ++generation;
+        }
+        wake.notify_all();
+
+        checkLines(0, lines);
+
+        if (threads > 1)
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&]() { return busy == 0; });
+        }
+
+        for (size_t i = 0; i < lines; ++i)
+        {
+            const size_t lineNo = stats.lines + i + 1;
+            const bool a = verdicts[i * count];
+            stats.accepted[0] += a;
+
+            if (count == 1)
+            {
+                out << lineNo << '\t' << (a ? "accepted" : "rejected") << '\t' << batch[i] << '\n';
+                continue;
+            }
+
+            const bool b = verdicts[i * count + 1];
+            stats.accepted[1] += b;
+            if (a != b)
+            {
+                ++stats.differences;
+                out << lineNo << '\t' << (a ? "G1 only" : "G2 only") << '\t' << batch[i] << '\n';
+            }
+        }
+
+        stats.lines += lines;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        finished = true;
+    }
+    wake.notify_all();
+    pool.clear();
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    return stats;
+}
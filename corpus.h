@@ -0,0 +1,61 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __CORPUS_H__
+#define __CORPUS_H__
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "grammar.h"
+#include "cyk.h"
+
+// how a corpus line is split into terminals
+enum class Tokenizer
+{
+    Chars, // every byte is a terminal, as tokenizeChars does
+    Words // whitespace separates terminals
+};
+
+struct CorpusStats
+{
+    size_t lines = 0;
+    size_t accepted[2] = { 0, 0 }; // per grammar
+    size_t differences = 0; // lines exactly one of two grammars accepts
+    double seconds = 0.0;
+};
+
+/*
+ * check every line of a corpus against one or two CNF grammars. lines are read in
+ * batches of batchLines and each batch is split across threads workers, started once
+ * for the whole run, so memory stays bounded by the batch no matter how long the
+ * corpus is. results are written
+ * in input order: with one grammar every line gets a verdict, with two only the
+ * lines they disagree on are written.
+ */
+CorpusStats checkCorpus(
+    std::istream& in,
+    const std::vector<const Grammar*>& grammars,
+    const std::vector<const CykIndex*>& indexes,
+    Tokenizer tokenizer,
+    size_t threads,
+    size_t batchLines,
+    std::ostream& out);
+
+#endif
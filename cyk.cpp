@@ -17,15 +17,40 @@
 
 
 #include "cyk.h"
+#include "stats.h"
+#include "adaptive.h"
+#include "uniform.h"
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <thread>
+#include <sys/resource.h>
 /*
- * PairHash is a small helper that tells unordered_map how to hash std::pair<std::string, std::string>
+ * PairHash is a small helper that tells unordered_map how to hash std::pair<SymbolId, SymbolId>
  */
-size_t PairHash::operator()(const std::pair<std::string, std::string>& p) const noexcept
+size_t PairHash::operator()(const std::pair<SymbolId, SymbolId>& p) const noexcept
 {
-    // this combines the hash of the strings into one number.
-    return std::hash<std::string>{}(p.first) * 1315423911u
-        ^ std::hash<std::string>{}(p.second);
+    // both ids fit in 32 bits, so pack them into one 64 bit value and mix it
+    uint64_t k = (static_cast<uint64_t>(p.first) << 32) | p.second;
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    return static_cast<size_t>(k);
+}
+
+/*
+ * WordHash hashes a string of terminal ids, used for the set of already tested strings
+ */
+size_t WordHash::operator()(const std::vector<SymbolId>& w) const noexcept
+{
+    size_t h = w.size();
+    for (SymbolId t : w)
+    {
+        h ^= t + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    }
+    return h;
 }
 
 /*
@@ -38,17 +63,24 @@ size_t PairHash::operator()(const std::pair<std::string, std::string>& p) const
 CykIndex buildCykIndex(const Grammar& g)
 {
     CykIndex idx;
+    idx.termMap.resize(g.symbols.terminalCount());
+
+    auto addUnique = [](std::vector<SymbolId>& v, SymbolId a)
+    {
+        if (std::find(v.begin(), v.end(), a) == v.end())
+            v.push_back(a);
+    };
 
     for (const auto& r : g.rules)
     {
         for (const auto& prod : r.rhs)
         {
             // if the production is a terminal production. put the production in the termMap
-            if (prod.size() == 1 && prod[0].isTerminal && prod[0].name != "epsilon")
-                idx.termMap[prod[0].name].insert(r.lhs);
+            if (prod.size() == 1 && prod[0].isTerminal && prod[0].id != EPSILON_ID)
+                addUnique(idx.termMap[prod[0].id], r.lhs);
             // if the production is a nonterminal binary production. put the production in the binMap
             else if (prod.size() == 2 && !prod[0].isTerminal && !prod[1].isTerminal)
-                idx.binMap[{prod[0].name, prod[1].name}].insert(r.lhs);
+                addUnique(idx.binMap[{prod[0].id, prod[1].id}], r.lhs);
         }
     }
 
@@ -56,45 +88,32 @@ CykIndex buildCykIndex(const Grammar& g)
 }
 
 
+
 /*
  * function to decide whether a given string is accepted by the CFG
  */
-bool cykAccepts(const Grammar& g, const CykIndex& idx, const std::string& startSymbol, const std::vector<std::string>& w)
+bool cykAccepts(const Grammar& g, const CykIndex& idx, SymbolId startSymbol, const std::vector<SymbolId>& w)
 {
     const size_t n = w.size();
+    STAT_ADD(cykCalls, 1);
 
     // if the string has a size of zero, then it must be an epsilon production.
-    // return true if the start symbol does not produce epsilon, return false, else true
     if (n == 0)
-    {
-        for (const auto& r : g.rules)
-        {
-            if (r.lhs != startSymbol)
-                continue;
-
-            for (const auto& prod : r.rhs)
-            {
-                if (prod.size() == 1 && prod[0].isTerminal && prod[0].name == "epsilon")
-                    return true;
-            }
-        }
-
-        return false;
-    }
+        return g.acceptsEmpty(startSymbol);
 
     // Create the CYK DP table T
     // T[i][len] = the set of nonterminals that can generate the substring starting at position i of length len
-    std::vector<std::vector<std::unordered_set<std::string>>> T(
-        n, std::vector<std::unordered_set<std::string>>(n + 1)
+    std::vector<std::vector<std::unordered_set<SymbolId>>> T(
+        n, std::vector<std::unordered_set<SymbolId>>(n + 1)
     );
 
     // base case len = 1
+    // terminals the grammar has never seen (NO_SYMBOL) produce an empty cell
     for (size_t i = 0; i < n; ++i)
     {
-        auto it = idx.termMap.find(w[i]);
-
-        if (it != idx.termMap.end())
-            T[i][1] = it->second;
+        if (w[i] < idx.termMap.size())
+            T[i][1].insert(idx.termMap[w[i]].begin(), idx.termMap[w[i]].end());
+        STAT_CELL(T[i][1].size());
     }
 
     // induction: length >= 2
@@ -110,9 +129,9 @@ bool cykAccepts(const Grammar& g, const CykIndex& idx, const std::string& startS
                 if (leftSet.empty() || rightSet.empty())
                     continue;
 
-                for (const auto& B : leftSet)
+                for (SymbolId B : leftSet)
                 {
-                    for (const auto& C : rightSet)
+                    for (SymbolId C : rightSet)
                     {
                         auto it = idx.binMap.find({B, C});
                         if (it != idx.binMap.end())
@@ -120,12 +139,288 @@ bool cykAccepts(const Grammar& g, const CykIndex& idx, const std::string& startS
                     }
                 }
             }
+            STAT_CELL(T[i][len].size());
         }
     }
 
     return T[0][n].count(startSymbol) > 0;
 }
 
+BitCykIndex buildBitCykIndex(const Grammar& g, const CykIndex& idx)
+{
+    BitCykIndex b;
+    const size_t nts = g.symbols.nonterminalCount();
+    const size_t W = (nts + 63) / 64;
+    b.words = W;
+
+    auto setBit = [](uint64_t* row, SymbolId a)
+    {
+        row[a / 64] |= uint64_t{1} << (a % 64);
+    };
+
+    b.termRows.assign(idx.termMap.size() * W, 0);
+    for (size_t t = 0; t < idx.termMap.size(); ++t)
+    {
+        for (SymbolId A : idx.termMap[t])
+            setBit(&b.termRows[t * W], A);
+    }
+
+    // group the binary rules by their left child B, sorted by right child C
+    std::vector<std::vector<std::pair<SymbolId, const std::vector<SymbolId>*>>> byLeft(nts);
+    for (const auto& [bc, lhs] : idx.binMap)
+        byLeft[bc.first].push_back({ bc.second, &lhs });
+
+    b.rightMask.assign(nts * W, 0);
+    b.pairStart.assign(nts + 1, 0);
+
+    for (size_t B = 0; B < nts; ++B)
+    {
+        auto& pairs = byLeft[B];
+        std::sort(pairs.begin(), pairs.end(),
+                  [](const auto& x, const auto& y) { return x.first < y.first; });
+
+        b.pairStart[B] = b.pairRight.size();
+        for (const auto& [C, lhs] : pairs)
+        {
+            setBit(&b.rightMask[B * W], C);
+            b.pairRight.push_back(C);
+            b.pairLhs.resize(b.pairLhs.size() + W, 0);
+            uint64_t* row = &b.pairLhs[b.pairLhs.size() - W];
+            for (SymbolId A : *lhs)
+                setBit(row, A);
+        }
+    }
+    b.pairStart[nts] = b.pairRight.size();
+
+    return b;
+}
+
+void CykWorkspace::reserve(size_t n, size_t words)
+{
+    const size_t cells = n * (n + 1) / 2;
+    if (cells <= nonEmpty.size() && cells * words <= chart.size())
+        return;
+
+    chart.resize(std::max(chart.size(), cells * words));
+    nonEmpty.resize(std::max(nonEmpty.size(), cells));
+    ++allocations;
+}
+
+/*
+ * dst |= every A with A -> B C, B in left and C in right.
+ * probes counts the Bs whose pair row was searched and hits the pairs found there
+ */
+static void combineCells(const BitCykIndex& bidx, const uint64_t* left, const uint64_t* right, uint64_t* dst,
+                         uint64_t& probes, uint64_t& hits)
+{
+    const size_t W = bidx.words;
+
+    for (size_t bw = 0; bw < W; ++bw)
+    {
+        for (uint64_t bits = left[bw]; bits != 0; bits &= bits - 1)
+        {
+            const size_t B = bw * 64 + std::countr_zero(bits);
+            size_t p = bidx.pairStart[B];
+            if (p == bidx.pairStart[B + 1])
+                continue;
+
+            // every C present in both the right cell and B's row mask has a pair entry;
+            // both run in increasing order so the entries are found by walking forward
+            ++probes;
+            const uint64_t* mask = &bidx.rightMask[B * W];
+            for (size_t cw = 0; cw < W; ++cw)
+            {
+                for (uint64_t hit = right[cw] & mask[cw]; hit != 0; hit &= hit - 1)
+                {
+                    const SymbolId C = static_cast<SymbolId>(cw * 64 + std::countr_zero(hit));
+                    while (bidx.pairRight[p] < C)
+                        ++p;
+
+                    ++hits;
+                    const uint64_t* lhs = &bidx.pairLhs[p * W];
+                    for (size_t x = 0; x < W; ++x)
+                        dst[x] |= lhs[x];
+                }
+            }
+        }
+    }
+}
+
+// number of nonterminals in a cell, for the cell size statistics
+[[maybe_unused]] static size_t cellSize(const uint64_t* cell, size_t W)
+{
+    size_t n = 0;
+    for (size_t x = 0; x < W; ++x)
+        n += std::popcount(cell[x]);
+    return n;
+}
+
+bool cykAcceptsBits(const Grammar& g, const BitCykIndex& bidx, SymbolId startSymbol, const std::vector<SymbolId>& w, CykWorkspace& ws)
+{
+    const size_t n = w.size();
+    STAT_ADD(cykCalls, 1);
+    if (n == 0)
+        return g.acceptsEmpty(startSymbol);
+
+    const size_t W = bidx.words;
+    if (W == 0)
+        return false;
+
+    // triangular chart: row len holds the n - len + 1 cells of that length,
+    // cell(i, len) covers the substring starting at i of length len
+    auto cellIndex = [n](size_t i, size_t len) -> size_t
+    {
+        return (len - 1) * n - (len - 1) * (len - 2) / 2 + i;
+    };
+
+    ws.reserve(n, W);
+    uint64_t* T = ws.chart.data();
+    char* nonEmpty = ws.nonEmpty.data();
+    uint64_t probes = 0, hits = 0; // added to the statistics once per call
+
+    // base case len = 1
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t* dst = &T[cellIndex(i, 1) * W];
+        if (w[i] >= bidx.termRows.size() / W)
+        {
+            std::fill(dst, dst + W, 0);
+            nonEmpty[cellIndex(i, 1)] = 0;
+            STAT_CELL(0);
+            continue;
+        }
+
+        const uint64_t* src = &bidx.termRows[w[i] * W];
+        uint64_t any = 0;
+        for (size_t x = 0; x < W; ++x)
+        {
+            dst[x] = src[x];
+            any |= src[x];
+        }
+        nonEmpty[cellIndex(i, 1)] = any != 0;
+        STAT_CELL(cellSize(dst, W));
+    }
+
+    // induction: length >= 2
+    for (size_t len = 2; len <= n; ++len)
+    {
+        for (size_t i = 0; i + len <= n; ++i)
+        {
+            const size_t target = cellIndex(i, len);
+            uint64_t* dst = &T[target * W];
+            std::fill(dst, dst + W, 0);
+
+            for (size_t k = 1; k < len; ++k)
+            {
+                const size_t l = cellIndex(i, k);
+                const size_t r = cellIndex(i + k, len - k);
+                if (!nonEmpty[l] || !nonEmpty[r])
+                    continue;
+
+                combineCells(bidx, &T[l * W], &T[r * W], dst, probes, hits);
+            }
+
+            uint64_t any = 0;
+            for (size_t x = 0; x < W; ++x)
+                any |= dst[x];
+            nonEmpty[target] = any != 0;
+            STAT_CELL(any ? cellSize(dst, W) : 0);
+        }
+    }
+
+    STAT_ADD(pairProbes, probes);
+    STAT_ADD(pairHits, hits);
+
+    const uint64_t* top = &T[cellIndex(0, n) * W];
+    return (top[startSymbol / 64] >> (startSymbol % 64)) & 1;
+}
+
+/*
+ * cells are stored by their end position: the cells ending at `end` are
+ * cell(0, end) .. cell(end - 1, end), and they sit at end * (end - 1) / 2 + start
+ */
+static size_t prefixCell(size_t start, size_t end)
+{
+    return end * (end - 1) / 2 + start;
+}
+
+void PrefixChart::reset(const BitCykIndex& index, size_t maxLen)
+{
+    bidx = &index;
+    len = 0;
+
+    const size_t cells = maxLen * (maxLen + 1) / 2;
+    chart.resize(std::max(chart.size(), cells * index.words));
+    nonEmpty.resize(std::max(nonEmpty.size(), cells));
+}
+
+/*
+ * compute the column for the new last position from right to left, so every
+ * cell(k, end) a split needs is already done when cell(start, end) is built
+ */
+void PrefixChart::push(SymbolId terminal)
+{
+    const size_t W = bidx->words;
+    const size_t end = ++len;
+
+    uint64_t* base = chart.data();
+    uint64_t* last = base + prefixCell(end - 1, end) * W;
+
+    if (terminal < bidx->termRows.size() / std::max<size_t>(W, 1))
+        std::copy(&bidx->termRows[terminal * W], &bidx->termRows[terminal * W] + W, last);
+    else
+        std::fill(last, last + W, 0);
+
+    auto anyBits = [W](const uint64_t* row) -> char
+    {
+        uint64_t any = 0;
+        for (size_t x = 0; x < W; ++x)
+            any |= row[x];
+        return any != 0;
+    };
+
+    nonEmpty[prefixCell(end - 1, end)] = anyBits(last);
+
+    // enumeration is not counted in the statistics
+    uint64_t probes = 0, hits = 0;
+
+    for (size_t start = end - 1; start-- > 0;)
+    {
+        const size_t target = prefixCell(start, end);
+        uint64_t* dst = base + target * W;
+        std::fill(dst, dst + W, 0);
+
+        for (size_t k = start + 1; k < end; ++k)
+        {
+            const size_t l = prefixCell(start, k);
+            const size_t r = prefixCell(k, end);
+            if (nonEmpty[l] && nonEmpty[r])
+                combineCells(*bidx, base + l * W, base + r * W, dst, probes, hits);
+        }
+
+        nonEmpty[target] = anyBits(dst);
+    }
+}
+
+void PrefixChart::pop()
+{
+    --len;
+}
+
+size_t PrefixChart::size() const
+{
+    return len;
+}
+
+bool PrefixChart::accepts(SymbolId startSymbol) const
+{
+    if (len == 0 || bidx->words == 0)
+        return false;
+
+    const uint64_t* top = chart.data() + prefixCell(0, len) * bidx->words;
+    return (top[startSymbol / 64] >> (startSymbol % 64)) & 1;
+}
+
 std::vector<std::string> tokenizeChars(const std::string& s)
 {
     std::vector<std::string> w;
@@ -137,26 +432,24 @@ std::vector<std::string> tokenizeChars(const std::string& s)
     return w;
 }
 
-size_t countTerminals(const std::vector<Symbol>& sentential)
+std::vector<SymbolId> buildTerminalMap(const SymbolTable& from, const SymbolTable& to)
 {
-    size_t count = 0;
-    for (const auto& sym : sentential)
+    std::vector<SymbolId> m(from.terminalCount(), NO_SYMBOL);
+    m[EPSILON_ID] = EPSILON_ID;
+    for (SymbolId t = 1; t < from.terminalCount(); ++t)
     {
-        if (sym.isTerminal && sym.name != "epsilon")
-            count++;
+        m[t] = to.findTerminal(from.terminalName(t));
     }
-    return count;
+    return m;
 }
 
-std::vector<size_t> nonterminalPositions(const std::vector<Symbol>& sentential)
+void translateWord(const std::vector<SymbolId>& terminalMap, const std::vector<SymbolId>& w, std::vector<SymbolId>& out)
 {
-    std::vector<size_t> pos;
-    for (size_t i = 0; i < sentential.size(); ++i)
+    out.clear();
+    for (SymbolId t : w)
     {
-        if (!sentential[i].isTerminal)
-            pos.push_back(i);
+        out.push_back(terminalMap[t]);
     }
-    return pos;
 }
 
 size_t countNonterminalsInProd(const std::vector<Symbol>& prod)
@@ -175,12 +468,55 @@ size_t countTerminalsInProd(const std::vector<Symbol>& prod)
     size_t count = 0;
     for (const auto& sym : prod)
     {
-        if (sym.isTerminal && sym.name != "epsilon")
+        if (sym.isTerminal && sym.id != EPSILON_ID)
             count++;
     }
     return count;
 }
 
+size_t genRegime(size_t currentLen, size_t stepsUsed, const GenSettings& cfg)
+{
+    size_t regime = 0;
+
+    const bool nearLenLimit = currentLen >= cfg.targetMax;
+    const bool nearStepLimit = stepsUsed >= (cfg.maxSteps * 3) / 4;
+
+    if (nearLenLimit || nearStepLimit)
+        regime |= REGIME_NEAR_LIMIT;
+    if (currentLen < cfg.targetMin)
+        regime |= REGIME_BELOW_MIN;
+    if (currentLen > cfg.targetMax)
+        regime |= REGIME_ABOVE_MAX;
+
+    return regime;
+}
+
+double alternativeWeight(const std::vector<Symbol>& prod, size_t nt, size_t tm, size_t regime, double expansionBias)
+{
+    if (prod.size() == 1 && prod[0].isTerminal && prod[0].id == EPSILON_ID)
+        return (regime & REGIME_BELOW_MIN) ? 0.1 : 0.6;
+
+    double w = 1.0;
+
+    // if near limits, prefer productions that reduce nonterminals
+    if (regime & REGIME_NEAR_LIMIT)
+        w *= 1.0 / (1.0 + nt);
+
+    if (regime & REGIME_BELOW_MIN)
+        w *= (1.0 + tm);
+
+    if (regime & REGIME_ABOVE_MAX)
+        w *= 1.0 / (1.0 + tm);
+
+    // below 1 favors alternatives that finish the derivation, above 1 ones that grow it
+    if (expansionBias != 1.0)
+        w *= std::pow(expansionBias, static_cast<double>(nt));
+
+    return w;
+}
+
+static_assert(GEN_REGIMES == STATS_REGIMES, "one choice counter per generation regime");
+
 size_t chooseAlternativeIndex(
     const std::vector<std::vector<Symbol>>& alts,
     std::mt19937_64& rng,
@@ -188,38 +524,15 @@ size_t chooseAlternativeIndex(
     size_t stepsUsed,
     const GenSettings& cfg)
 {
-    auto isEpsilonProd = [](const std::vector<Symbol>& prod) -> bool
-    {
-        return prod.size() == 1 && prod[0].isTerminal && prod[0].name == "epsilon";
-    };
+    const size_t regime = genRegime(currentLen, stepsUsed, cfg);
+    STAT_ADD(alternativeChoices, 1);
+    STAT_ADD(regimeChoices[regime], 1);
 
     std::vector<double> w(alts.size(), 1.0);
-
-    const bool nearLenLimit = currentLen >= cfg.targetMax;
-    const bool nearStepLimit = stepsUsed >= (cfg.maxSteps * 3) / 4;
-
     for (size_t i = 0; i < alts.size(); ++i)
     {
         const auto& prod = alts[i];
-
-        if (isEpsilonProd(prod))
-        {
-            w[i] *= (currentLen < cfg.targetMin) ? 0.1 : 0.6;
-            continue;
-        }
-
-        const size_t nt = countNonterminalsInProd(prod);
-        const size_t tm = countTerminalsInProd(prod);
-
-        // if near limits, prefer productions that reduce nonterminals
-        if (nearLenLimit || nearStepLimit)
-            w[i] *= 1.0 / (1.0 + nt);
-
-        if (currentLen < cfg.targetMin)
-            w[i] *= (1.0 + tm);
-
-        if (currentLen > cfg.targetMax)
-            w[i] *= 1.0 / (1.0 + tm);
+        w[i] = alternativeWeight(prod, countNonterminalsInProd(prod), countTerminalsInProd(prod), regime, cfg.expansionBias);
     }
 
     double sum = 0.0;
@@ -238,154 +551,619 @@ size_t chooseAlternativeIndex(
     return dist(rng);
 }
 
+/*
+ * Vose's alias method: split the weights into n columns of height 1, each holding
+ * at most two outcomes, so a sample is one column pick and one coin flip
+ */
+void AliasTable::build(const std::vector<double>& weights)
+{
+    const size_t n = weights.size();
+    prob.assign(n, 1.0);
+    alias.assign(n, 0);
+
+    double sum = 0.0;
+    for (double x : weights)
+        sum += x;
+
+    // all zero weights fall back to uniform, like chooseAlternativeIndex
+    if (n == 0 || sum <= 0.0)
+    {
+        for (size_t i = 0; i < n; ++i)
+            alias[i] = static_cast<uint32_t>(i);
+        return;
+    }
 
-std::optional<std::vector<std::string>> generateString(
-    const RuleMap& rm,
-    const std::string& startSymbol,
+    std::vector<double> scaled(n);
+    std::vector<uint32_t> small, large;
+    for (size_t i = 0; i < n; ++i)
+    {
+        scaled[i] = weights[i] * n / sum;
+        (scaled[i] < 1.0 ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    while (!small.empty() && !large.empty())
+    {
+        uint32_t s = small.back();
+        small.pop_back();
+        uint32_t l = large.back();
+
+        prob[s] = scaled[s];
+        alias[s] = l;
+        scaled[l] -= 1.0 - scaled[s];
+
+        if (scaled[l] < 1.0)
+        {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+
+    // whatever is left is 1 up to rounding error
+    for (uint32_t i : large)
+    {
+        prob[i] = 1.0;
+        alias[i] = i;
+    }
+    for (uint32_t i : small)
+    {
+        prob[i] = 1.0;
+        alias[i] = i;
+    }
+}
+
+size_t AliasTable::sample(std::mt19937_64& rng) const
+{
+    // the high half of one draw picks the column, the low half is the coin
+    const uint64_t r = rng();
+    const size_t col = static_cast<size_t>(((r >> 32) * prob.size()) >> 32);
+    const double coin = static_cast<double>(r & 0xffffffffu) * (1.0 / 4294967296.0);
+    return coin < prob[col] ? col : alias[col];
+}
+
+CompiledRuleMap compileRuleMap(const RuleMap& rm, double expansionBias)
+{
+    CompiledRuleMap crm(rm.size());
+
+    for (size_t A = 0; A < rm.size(); ++A)
+    {
+        CompiledAlternatives& ca = crm[A];
+        ca.prods = rm[A];
+        ca.nonterminals.reserve(ca.prods.size());
+        ca.terminals.reserve(ca.prods.size());
+
+        for (const auto& prod : ca.prods)
+        {
+            ca.nonterminals.push_back(countNonterminalsInProd(prod));
+            ca.terminals.push_back(countTerminalsInProd(prod));
+        }
+    }
+
+    reweightRuleMap(crm, expansionBias);
+    return crm;
+}
+
+void reweightRuleMap(CompiledRuleMap& crm, double expansionBias)
+{
+    std::vector<double> w;
+    for (CompiledAlternatives& ca : crm)
+    {
+        w.resize(ca.prods.size());
+        for (size_t regime = 0; regime < GEN_REGIMES; ++regime)
+        {
+            for (size_t i = 0; i < ca.prods.size(); ++i)
+                w[i] = alternativeWeight(ca.prods[i], ca.nonterminals[i], ca.terminals[i], regime, expansionBias);
+            ca.tables[regime].build(w);
+        }
+    }
+}
+
+size_t chooseCompiledAlternative(
+    const CompiledAlternatives& ca,
     std::mt19937_64& rng,
+    size_t currentLen,
+    size_t stepsUsed,
     const GenSettings& cfg)
 {
-    auto isEpsilonProd = [](const std::vector<Symbol>& prod) -> bool
-    {
-        return prod.size() == 1 && prod[0].isTerminal && prod[0].name == "epsilon";
-    };
+    // a lone alternative is no choice, and is counted in neither total
+    if (ca.prods.size() == 1)
+        return 0;
+
+    const size_t regime = genRegime(currentLen, stepsUsed, cfg);
+    STAT_ADD(alternativeChoices, 1);
+    STAT_ADD(regimeChoices[regime], 1);
+    return ca.tables[regime].sample(rng);
+}
+
+
+/*
+ * the sentential form is a singly linked list of nodes in ws.nodes. expanding a
+ * nonterminal rewrites its node in place as the first symbol of the production and
+ * links the rest in after it, so a step costs O(production length). ws.live holds
+ * the nodes that are still nonterminals (in no particular order) for the random pick,
+ * and the leftmost nonterminal is found with a cursor that only ever moves right,
+ * since everything before the leftmost nonterminal is already a terminal.
+ */
+std::optional<std::vector<SymbolId>> generateString(
+    const CompiledRuleMap& crm,
+    SymbolId startSymbol,
+    std::mt19937_64& rng,
+    const GenSettings& cfg,
+    DerivationWorkspace& ws)
+{
+    constexpr uint32_t END = UINT32_MAX;
+
+    auto& nodes = ws.nodes;
+    auto& live = ws.live;
+    nodes.clear();
+    live.clear();
+    ws.failure = GenFailure::None;
+
+    STAT_ADD(derivations, 1);
+    nodes.push_back({ Symbol{ false, startSymbol }, END, 0 });
+    live.push_back(0);
 
-    std::vector<Symbol> sentential;
-    sentential.push_back(Symbol{ false, startSymbol });
+    uint32_t leftmost = 0;
+    size_t curLen = 0; // terminals so far, epsilon not counted
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
 
     for (size_t step = 0; step < cfg.maxSteps; ++step)
     {
-        const auto nts = nonterminalPositions(sentential);
-
-        if (nts.empty())
+        if (live.empty())
         {
-            std::vector<std::string> out;
-            out.reserve(sentential.size());
+            if (curLen > cfg.maxLen)
+            {
+                STAT_ADD(abandonedMaxLen, 1);
+                ws.failure = GenFailure::MaxLen;
+                return std::nullopt;
+            }
 
-            for (const auto& s : sentential)
+            std::vector<SymbolId> out;
+            out.reserve(curLen);
+
+            for (uint32_t x = 0; x != END; x = nodes[x].next)
             {
-                if (s.isTerminal && s.name != "epsilon")
-                    out.push_back(s.name);
+                if (nodes[x].sym.id != EPSILON_ID)
+                    out.push_back(nodes[x].sym.id);
             }
 
-            if (out.size() <= cfg.maxLen)
-                return out;
-            return std::nullopt;
+            STAT_LENGTH(out.size());
+            return out;
         }
 
-        const size_t curLen = countTerminals(sentential);
         if (curLen > cfg.maxLen)
+        {
+            STAT_ADD(abandonedMaxLen, 1);
+            ws.failure = GenFailure::MaxLen;
             return std::nullopt;
+        }
+
+        while (nodes[leftmost].sym.isTerminal)
+            leftmost = nodes[leftmost].next;
 
-        size_t pos = nts.front();
-        std::uniform_real_distribution<double> coin(0.0, 1.0);
+        uint32_t pos = leftmost;
 
-        if (coin(rng) > cfg.pLeftmost)
+        // with one nonterminal left, leftmost and random are the same node
+        if (live.size() > 1 && coin(rng) > cfg.pLeftmost)
         {
-            std::uniform_int_distribution<size_t> pick(0, nts.size() - 1);
-            pos = nts[pick(rng)];
+            std::uniform_int_distribution<size_t> pick(0, live.size() - 1);
+            pos = live[pick(rng)];
         }
 
-        const std::string A = sentential[pos].name;
+        const SymbolId A = nodes[pos].sym.id;
 
-        auto it = rm.find(A);
-        if (it == rm.end() || it->second.empty())
+        if (A >= crm.size() || crm[A].prods.empty())
+        {
+            STAT_ADD(abandonedMissingRule, 1);
+            ws.failure = GenFailure::MissingRule;
             return std::nullopt;
+        }
 
-        const auto& alts = it->second;
-        const size_t altIdx = chooseAlternativeIndex(alts, rng, curLen, step, cfg);
-        const auto& prod = alts[altIdx];
-
-        std::vector<Symbol> next;
-        next.reserve(sentential.size() + prod.size());
-        next.insert(next.end(), sentential.begin(), sentential.begin() + pos);
+        const auto& alts = crm[A];
+        const size_t altIdx = chooseCompiledAlternative(alts, rng, curLen, step, cfg);
+        const auto& prod = alts.prods[altIdx];
 
-        if (!isEpsilonProd(prod))
-            next.insert(next.end(), prod.begin(), prod.end());
+        // take pos out of the live set by moving the last entry into its slot
+        const uint32_t slot = nodes[pos].live;
+        live[slot] = live.back();
+        nodes[live[slot]].live = slot;
+        live.pop_back();
 
-        next.insert(next.end(), sentential.begin() + pos + 1, sentential.end());
+        // an epsilon production leaves an epsilon terminal behind, which is skipped on output
+        const uint32_t after = nodes[pos].next;
+        uint32_t prev = pos;
+        for (size_t i = 0; i < prod.size(); ++i)
+        {
+            uint32_t x = pos;
+            if (i > 0)
+            {
+                x = static_cast<uint32_t>(nodes.size());
+                nodes.push_back({});
+                nodes[prev].next = x;
+            }
 
-        sentential = std::move(next);
+            nodes[x].sym = prod[i];
+            if (!prod[i].isTerminal)
+            {
+                nodes[x].live = static_cast<uint32_t>(live.size());
+                live.push_back(x);
+            }
+            else if (prod[i].id != EPSILON_ID)
+            {
+                ++curLen;
+            }
+            prev = x;
+        }
+        nodes[prev].next = after;
     }
 
-    return std::nullopt; // step limit
+    STAT_ADD(abandonedStepLimit, 1);
+    ws.failure = GenFailure::StepLimit;
+    return std::nullopt;
 }
 
-std::string joinTokens(const std::vector<std::string>& w)
+std::string joinTokens(const SymbolTable& symbols, const std::vector<SymbolId>& w)
 {
     std::string s;
-    for (const auto& t : w)
+    for (SymbolId t : w)
     {
-        s += t;
+        s += symbols.terminalName(t);
     }
     return s;
 }
 
 RuleMap buildRuleMap(const Grammar& g)
 {
-    RuleMap m;
-    for (const auto& r : g.rules)
+    // gather every rule an lhs heads, not just the last one
+    RuleMap m(g.symbols.nonterminalCount());
+    for (SymbolId A = 0; A < g.byLhs.size(); ++A)
     {
-        m[r.lhs] = r.rhs;
+        m[A].reserve(g.byLhs[A].size());
+        for (uint32_t p : g.byLhs[A])
+            m[A].push_back(g.production(p));
     }
     return m;
 }
 
+/*
+ * seed for one search worker. worker 0 keeps the base seed so a single
+ * worker reproduces the sequential search, the others get splitmix64
+ * scrambles of it so their streams do not overlap
+ */
+static uint64_t workerSeed(uint64_t seed, size_t worker)
+{
+    if (worker == 0)
+        return seed;
+
+    uint64_t z = seed + worker * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
 DiffResult findCounterExample(
     const Grammar& g1,
-    const std::string& s1,
+    SymbolId s1,
     const CykIndex& idx1,
     const Grammar& g2,
-    const std::string& s2,
+    SymbolId s2,
     const CykIndex& idx2,
     size_t trials,
     uint64_t seed,
-    const GenSettings& cfg)
+    const GenSettings& cfg,
+    size_t threads)
 {
-    std::mt19937_64 rng(seed);
+    const SearchTables t1 = buildSearchTables(g1, s1, idx1, cfg);
+    const SearchTables t2 = buildSearchTables(g2, s2, idx2, cfg);
+    SearchBudget budget;
+    budget.trials = trials;
+    return findCounterExample(t1, t2, budget, seed, cfg, threads);
+}
 
-    RuleMap rm1 = buildRuleMap(g1);
-    RuleMap rm2 = buildRuleMap(g2);
+SearchTables buildSearchTables(const Grammar& g, SymbolId start, const CykIndex& idx, const GenSettings& cfg)
+{
+    SearchTables t;
+    t.grammar = &g;
+    t.start = start;
+    t.rules = compileRuleMap(buildRuleMap(g), cfg.expansionBias);
+    t.bits = buildBitCykIndex(g, idx);
+
+    // uniform mode only needs the counting tables
+    if (cfg.uniform)
+    {
+        t.uniform = buildUniformSampler(g, start, cfg.maxLen);
+        t.lengths = feasibleLengths(t.uniform);
+    }
 
-    std::unordered_set<std::string> seen;
+    return t;
+}
 
-    auto testOne = [&](const Grammar& genG, const RuleMap& rmG, const std::string& startG,
-                       const Grammar& otherG, const std::string& startO,
-                       const CykIndex& idxG, const CykIndex& idxO) -> DiffResult
+const char* searchStopName(SearchStop stop)
+{
+    switch (stop)
     {
-        for (size_t t = 0; t < trials; ++t)
+    case SearchStop::Found:
+        return "witness found";
+    case SearchStop::Trials:
+        return "trial limit";
+    case SearchStop::Time:
+        return "time budget";
+    case SearchStop::Memory:
+        return "memory budget";
+    }
+    return "unknown";
+}
+
+size_t peakResidentMemory()
+{
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+    // ru_maxrss is in kilobytes on Linux
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+/*
+ * trials are dealt round robin: worker k runs trials k, k + threads, ... of each direction
+ * with its own rng, seen set and workspace. the directions take turns in rounds of
+ * SEARCH_ROUND_TRIALS trials, and every trial has a global index that orders it by round,
+ * then direction, then position. the reported witness is always the one with the smallest
+ * index, so without a time or memory budget the result only depends on the seed and the
+ * thread count. once a witness is known, workers stop as soon as they pass its index.
+ * a worker that finds the time or memory budget used up stops every worker.
+ */
+DiffResult findCounterExample(
+    const SearchTables& t1,
+    const SearchTables& t2,
+    const SearchBudget& budget,
+    uint64_t seed,
+    const GenSettings& cfg,
+    size_t threads)
+{
+    threads = std::max<size_t>(threads, 1);
+    const size_t trials = budget.trials;
+
+    const Grammar& g1 = *t1.grammar;
+    const Grammar& g2 = *t2.grammar;
+
+    const auto started = std::chrono::steady_clock::now();
+    const bool timed = budget.seconds > 0.0;
+    const auto deadline = started + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(timed ? budget.seconds : 0.0));
+    const bool limited = timed || budget.maxMemory > 0;
+
+    // terminal ids are local to each grammar, so strings are translated before
+    // being checked against the other one
+    const std::vector<SymbolId> map12 = buildTerminalMap(g1.symbols, g2.symbols);
+    const std::vector<SymbolId> map21 = buildTerminalMap(g2.symbols, g1.symbols);
+
+    auto trialIndex = [](size_t direction, size_t t)
+    {
+        return (t / SEARCH_ROUND_TRIALS) * 2 * SEARCH_ROUND_TRIALS + direction * SEARCH_ROUND_TRIALS + t % SEARCH_ROUND_TRIALS;
+    };
+
+    std::atomic<size_t> best{ SIZE_MAX };
+    std::atomic<int> budgetStop{ 0 }; // a SearchStop once a budget ran out, 0 before
+    std::vector<DiffResult> results(threads);
+    std::vector<size_t> foundAt(threads, SIZE_MAX);
+    std::vector<size_t> trialsRun(threads, 0);
+    std::vector<size_t> tested(threads, 0);
+    std::vector<std::vector<std::string>> tuningLogs(threads);
+
+    // uniform sampling has nothing to tune
+    const bool tuning = cfg.adaptive && !cfg.uniform;
+
+    auto runWorker = [&](size_t k)
+    {
+        StatsScope stats;
+        std::mt19937_64 rng(workerSeed(seed, k));
+
+        // strings are remembered by their grammar 1 ids so both directions share one set
+        std::unordered_set<std::vector<SymbolId>, WordHash> seen;
+        std::vector<SymbolId> wOther;
+        CykWorkspace ws;
+        DerivationWorkspace dws;
+
+        std::vector<SymbolId> drawn;
+        size_t untilCheck = SEARCH_BUDGET_INTERVAL;
+
+        // with --adaptive each direction has its own tuned settings, and its own copy
+        // of the rule map once the alternative weights have been changed
+        std::vector<GenTuner> tuners;
+        CompiledRuleMap tunedRules[2];
+        bool reweighted[2] = { false, false };
+        if (tuning)
         {
-            auto wOpt = generateString(rmG, startG, rng, cfg);
-            if (!wOpt)
-                continue;
+            const std::string worker = threads > 1 ? " (worker " + std::to_string(k) + ")" : "";
+            tuners.emplace_back(cfg, "G1" + worker);
+            tuners.emplace_back(cfg, "G2" + worker);
+        }
 
-            const auto& w = *wOpt;
-            std::string key = joinTokens(w);
+        auto tune = [&](size_t direction, const CompiledRuleMap& rmG, const std::vector<SymbolId>* w, bool fresh)
+        {
+            if (!tuning)
+                return;
+            GenTuner& tuner = tuners[direction];
+            tuner.record(w, dws.failure, fresh);
+            if (!tuner.retune(tuningLogs[k]))
+                return;
+            if (!reweighted[direction])
+            {
+                tunedRules[direction] = rmG;
+                reweighted[direction] = true;
+            }
+            reweightRuleMap(tunedRules[direction], tuner.settings().expansionBias);
+        };
 
-            if (!seen.insert(key).second)
-                continue;
+        auto draw = [&](size_t direction, const CompiledRuleMap& rmG, SymbolId startG,
+                        const UniformSampler& usG, const std::vector<size_t>& lengthsG) -> std::optional<std::vector<SymbolId>>
+        {
+            if (tuning)
+                return generateString(reweighted[direction] ? tunedRules[direction] : rmG, startG, rng,
+                                      tuners[direction].settings(), dws);
+            if (!cfg.uniform)
+                return generateString(rmG, startG, rng, cfg, dws);
+
+            if (lengthsG.empty())
+                return std::nullopt;
+
+            std::uniform_int_distribution<size_t> pickLen(0, lengthsG.size() - 1);
+            if (!sampleUniform(usG, lengthsG[pickLen(rng)], rng, drawn))
+                return std::nullopt;
+            return drawn;
+        };
+
+        // false once a budget ran out, checked every SEARCH_BUDGET_INTERVAL trials
+        auto withinBudget = [&]() -> bool
+        {
+            if (!limited || --untilCheck > 0)
+                return true;
+            untilCheck = SEARCH_BUDGET_INTERVAL;
+
+            if (budgetStop.load(std::memory_order_relaxed) != 0)
+                return false;
+            int reason = 0;
+            if (timed && std::chrono::steady_clock::now() >= deadline)
+                reason = static_cast<int>(SearchStop::Time);
+            else if (budget.maxMemory > 0 && peakResidentMemory() > budget.maxMemory)
+                reason = static_cast<int>(SearchStop::Memory);
+            if (reason == 0)
+                return true;
+
+            int none = 0;
+            budgetStop.compare_exchange_strong(none, reason);
+            return false;
+        };
+
+        // runs this worker's trials in [from, to) of one direction, true when it should stop
+        auto testRange = [&](const Grammar& genG, const CompiledRuleMap& rmG, SymbolId startG,
+                             const UniformSampler& usG, const std::vector<size_t>& lengthsG,
+                             const Grammar& otherG, SymbolId startO,
+                             const BitCykIndex& idxG, const BitCykIndex& idxO,
+                             const std::vector<SymbolId>& toOther, bool genIsG1,
+                             size_t from, size_t to) -> bool
+        {
+            const size_t direction = genIsG1 ? 0 : 1;
+
+            for (size_t t = from + (k + threads - from % threads) % threads; t < to; t += threads)
+            {
+                // a witness with a smaller index already exists
+                if (trialIndex(direction, t) > best.load(std::memory_order_relaxed))
+                    return true;
+                if (!withinBudget())
+                    return true;
+
+                ++trialsRun[k];
+                STAT_ADD(trials, 1);
+                auto wOpt = draw(direction, rmG, startG, usG, lengthsG);
+                if (!wOpt)
+                {
+                    tune(direction, rmG, nullptr, false);
+                    continue;
+                }
+
+                const auto& w = *wOpt;
+                translateWord(toOther, w, wOther);
+
+                // a string with a terminal grammar 1 has never seen has no grammar 1 key,
+                // and grammar 1 rejects it anyway, so it is simply not remembered
+                const auto& key = genIsG1 ? w : wOther;
+                const bool keyable = genIsG1 || std::find(wOther.begin(), wOther.end(), NO_SYMBOL) == wOther.end();
+
+                if (keyable && !seen.insert(key).second)
+                {
+                    STAT_ADD(duplicates, 1);
+                    tune(direction, rmG, &w, false);
+                    continue;
+                }
+                tune(direction, rmG, &w, true);
+
+                ++tested[k];
+                bool a = cykAcceptsBits(genG, idxG, startG, w, ws);
+                bool b = cykAcceptsBits(otherG, idxO, startO, wOther, ws);
+
+                if (!a)
+                {
+                    std::cerr << "[WARNING] Generator produced string not accepted by its own grammar:";
+                    continue;
+                }
+                if (a != b)
+                {
+                    DiffResult& r = results[k];
+                    r.found = true;
+                    r.witness = joinTokens(genG.symbols, w);
+                    r.g1Accepts = genIsG1 ? a : b;
+                    r.g2Accepts = genIsG1 ? b : a;
+                    for (SymbolId t : w)
+                        r.tokens.push_back(genG.symbols.terminalName(t));
+                    foundAt[k] = trialIndex(direction, t);
+
+                    size_t cur = best.load();
+                    while (foundAt[k] < cur && !best.compare_exchange_weak(cur, foundAt[k]))
+                    {
+                    }
+                    return true;
+                }
+            }
+            return false;
+        };
 
-            bool a = cykAccepts(genG, idxG, startG, w);
-            bool b = cykAccepts(otherG, idxO, startO, w);
+        for (size_t from = 0; from < trials; from += SEARCH_ROUND_TRIALS)
+        {
+            const size_t to = trials - from > SEARCH_ROUND_TRIALS ? from + SEARCH_ROUND_TRIALS : trials;
+
+            if (tuning)
+                tuners[0].resume();
+            if (testRange(g1, t1.rules, t1.start, t1.uniform, t1.lengths, g2, t2.start, t1.bits, t2.bits, map12, true, from, to))
+                return;
 
-            if (!a)
+            if (tuning)
             {
-                std::cerr << "[WARNING] Generator produced string not accepted by its own grammar:";
-                continue;
+                tuners[0].pause();
+                tuners[1].resume();
             }
-            if (a != b)
-                return DiffResult{true, key, a, b};
+            if (testRange(g2, t2.rules, t2.start, t2.uniform, t2.lengths, g1, t1.start, t2.bits, t1.bits, map21, false, from, to))
+                return;
+            if (tuning)
+                tuners[1].pause();
         }
-        return DiffResult{};
     };
 
-    if (auto r = testOne(g1, rm1, s1, g2, s2, idx1, idx2); r.found)
-        return r;
+    if (threads == 1)
+    {
+        runWorker(0);
+    }
+    else
+    {
+        std::vector<std::jthread> pool;
+        pool.reserve(threads);
+        for (size_t k = 0; k < threads; ++k)
+            pool.emplace_back(runWorker, k);
+    }
 
-    if (auto r = testOne(g2, rm2, s2, g1, s1, idx2, idx1); r.found)
-        return r;
+    DiffResult res;
+    const size_t winner = best.load();
+    for (size_t k = 0; k < threads && winner != SIZE_MAX; ++k)
+    {
+        if (foundAt[k] == winner)
+        {
+            res = results[k];
+            break;
+        }
+    }
 
-    return DiffResult{};
+    if (res.found)
+        res.stop = SearchStop::Found;
+    else if (budgetStop.load() != 0)
+        res.stop = static_cast<SearchStop>(budgetStop.load());
+    else
+        res.stop = SearchStop::Trials;
+    for (size_t k = 0; k < threads; ++k)
+    {
+        res.trials += trialsRun[k];
+        res.tested += tested[k];
+        res.tuningLog.insert(res.tuningLog.end(), tuningLogs[k].begin(), tuningLogs[k].end());
+    }
+    res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+    res.peakMemory = peakResidentMemory();
+    return res;
 }
-
-
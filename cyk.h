@@ -27,18 +27,76 @@
 #include <algorithm>
 #include <utility>
 #include "grammar.h"
+#include "uniform.h"
 
-using RuleMap = std::unordered_map<std::string, std::vector<std::vector<Symbol>>>;
+// productions for each nonterminal, indexed by nonterminal id
+using RuleMap = std::vector<std::vector<std::vector<Symbol>>>;
 
 struct PairHash
 {
-    size_t operator()(const std::pair<std::string, std::string>& p) const noexcept;
+    size_t operator()(const std::pair<SymbolId, SymbolId>& p) const noexcept;
+};
+
+struct WordHash
+{
+    size_t operator()(const std::vector<SymbolId>& w) const noexcept;
 };
 
 struct CykIndex
 {
-    std::unordered_map<std::string, std::unordered_set<std::string>> termMap;
-    std::unordered_map<std::pair<std::string, std::string>, std::unordered_set<std::string>, PairHash> binMap;
+    std::vector<std::vector<SymbolId>> termMap; // indexed by terminal id
+    std::unordered_map<std::pair<SymbolId, SymbolId>, std::vector<SymbolId>, PairHash> binMap;
+};
+
+/*
+ * BitCykIndex is the same information as CykIndex laid out for a bitset chart.
+ * every set of nonterminals is `words` 64 bit words wide, bit A set means A is in the set.
+ * binary rules A -> B C are grouped by B: rightMask[B] holds every C that pairs with B,
+ * and for each such C (sorted) pairLhs holds the set of A that produce B C.
+ */
+struct BitCykIndex
+{
+    size_t words = 0;
+    std::vector<uint64_t> termRows; // terminalCount * words
+    std::vector<uint64_t> rightMask; // nonterminalCount * words
+    std::vector<size_t> pairStart; // nonterminalCount + 1 offsets into pairRight
+    std::vector<SymbolId> pairRight;
+    std::vector<uint64_t> pairLhs; // pairRight.size() * words
+};
+
+/*
+ * CykWorkspace is the chart memory for cykAcceptsBits, owned by the caller and reused
+ * across calls. it only grows when a longer string (or wider grammar) than any seen
+ * before comes along, so once it has seen the largest input no call allocates.
+ * every cell is overwritten before it is read, so nothing needs clearing between strings.
+ */
+struct CykWorkspace
+{
+    std::vector<uint64_t> chart;
+    std::vector<char> nonEmpty;
+    size_t allocations = 0; // number of times the arena had to grow
+
+    void reserve(size_t n, size_t words);
+};
+
+/*
+ * PrefixChart is a bitset CYK chart built one terminal at a time. push adds the
+ * column of cells ending at the new position, pop drops it again, so strings that
+ * are visited in prefix order (e.g. by a depth first enumeration) only pay for the
+ * columns after their shared prefix. accepts only answers for non-empty strings.
+ */
+struct PrefixChart
+{
+    const BitCykIndex* bidx = nullptr;
+    size_t len = 0;
+    std::vector<uint64_t> chart;
+    std::vector<char> nonEmpty;
+
+    void reset(const BitCykIndex& index, size_t maxLen);
+    void push(SymbolId terminal);
+    void pop();
+    size_t size() const;
+    bool accepts(SymbolId startSymbol) const;
 };
 
 // settings for generating strings
@@ -49,36 +107,168 @@ struct GenSettings
     size_t targetMin = 1; // encourage lengths in this range
     size_t targetMax = 20;
     double pLeftmost = 0.8; // 80% expand leftmost NT, else random NT
+    bool uniform = false; // draw uniform derivation trees of a uniform feasible length instead
+    double expansionBias = 1.0; // weight factor per nonterminal in an alternative
+    bool adaptive = false; // retune these settings during a search, see GenTuner
+};
+
+// weighting regimes for choosing alternatives, combined as bit flags
+constexpr size_t REGIME_NEAR_LIMIT = 1; // near the length or step limit
+constexpr size_t REGIME_BELOW_MIN = 2; // shorter than targetMin
+constexpr size_t REGIME_ABOVE_MAX = 4; // longer than targetMax
+constexpr size_t GEN_REGIMES = 8;
+
+// O(1) sampler for a fixed discrete distribution (Vose's alias method)
+struct AliasTable
+{
+    std::vector<double> prob;
+    std::vector<uint32_t> alias;
+
+    void build(const std::vector<double>& weights);
+    size_t sample(std::mt19937_64& rng) const;
+};
+
+/*
+ * the alternatives of one nonterminal prepared for generation: the symbol counts of
+ * each production are computed once, and there is one alias table per regime
+ */
+struct CompiledAlternatives
+{
+    std::vector<std::vector<Symbol>> prods;
+    std::vector<size_t> nonterminals; // per production
+    std::vector<size_t> terminals; // per production, epsilon not counted
+    AliasTable tables[GEN_REGIMES];
+};
+
+// compiled form of RuleMap, indexed by nonterminal id
+using CompiledRuleMap = std::vector<CompiledAlternatives>;
+
+// why generateString gave up on a derivation
+enum class GenFailure
+{
+    None,
+    StepLimit, // cfg.maxSteps expansions were not enough
+    MaxLen, // more than cfg.maxLen terminals
+    MissingRule // a nonterminal without productions
+};
+
+/*
+ * scratch memory for generateString, reused across derivations.
+ * nodes is the sentential form as a linked list, live the nodes still holding nonterminals
+ */
+struct DerivationWorkspace
+{
+    struct Node
+    {
+        Symbol sym;
+        uint32_t next; // UINT32_MAX at the end of the form
+        uint32_t live; // slot in live while sym is a nonterminal
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> live;
+    GenFailure failure = GenFailure::None; // of the last derivation
+};
+
+/*
+ * everything the random search needs from one grammar: the compiled alternatives
+ * for generation, the bitset CYK index and, in uniform mode, the counting tables.
+ * built once per grammar, it can be shared by any number of comparisons, and it
+ * refers to the grammar it was built from, which must outlive it
+ */
+struct SearchTables
+{
+    const Grammar* grammar = nullptr;
+    SymbolId start = NO_SYMBOL;
+    CompiledRuleMap rules;
+    BitCykIndex bits;
+    UniformSampler uniform;
+    std::vector<size_t> lengths; // feasible lengths, uniform mode only
+};
+
+// why a random search ended
+enum class SearchStop
+{
+    Found, // a witness was found
+    Trials, // every trial was run
+    Time, // the time budget ran out
+    Memory // the process went over the memory budget
 };
 
+/*
+ * limits of one random search; it stops at whichever it reaches first.
+ * directions alternate in rounds of SEARCH_ROUND_TRIALS, so an unlimited (or very
+ * large) trial count still tries strings from both grammars
+ */
+struct SearchBudget
+{
+    size_t trials = 5000; // per direction, SIZE_MAX for no limit
+    double seconds = 0.0; // wall clock time of the search, 0 for no limit
+    size_t maxMemory = 0; // bytes of peak resident memory of the process, 0 for no limit
+};
+
+constexpr size_t SEARCH_ROUND_TRIALS = 5000;
+
+// the time and memory budgets are checked once every this many trials of a worker
+constexpr size_t SEARCH_BUDGET_INTERVAL = 64;
+
 struct DiffResult
 {
     bool found = false;
     std::string witness;
     bool g1Accepts = false;
     bool g2Accepts = false;
+    std::vector<std::string> tokens; // the witness split into its terminals
+
+    // work done, reported whether or not a witness was found
+    SearchStop stop = SearchStop::Trials;
+    size_t trials = 0; // trials run, both directions
+    size_t tested = 0; // distinct strings checked against both grammars
+    double seconds = 0.0;
+    size_t peakMemory = 0; // bytes, peak resident memory of the process
+    std::vector<std::string> tuningLog; // changes made by --adaptive, in worker order
 };
 
+const char* searchStopName(SearchStop stop);
+
 CykIndex buildCykIndex(const Grammar& g);
 
 bool cykAccepts(
     const Grammar& g,
     const CykIndex& idx,
-    const std::string& startSymbol,
-    const std::vector<std::string>& w);
+    SymbolId startSymbol,
+    const std::vector<SymbolId>& w);
+
+BitCykIndex buildBitCykIndex(const Grammar& g, const CykIndex& idx);
+
+// same result as cykAccepts, using a flat bitset chart instead of hash set cells
+bool cykAcceptsBits(
+    const Grammar& g,
+    const BitCykIndex& bidx,
+    SymbolId startSymbol,
+    const std::vector<SymbolId>& w,
+    CykWorkspace& ws);
 
 std::vector<std::string> tokenizeChars(const std::string& s);
 
-RuleMap buildRuleMap(const Grammar& g);
+// maps each terminal id of one grammar to the id of the same terminal in another (or NO_SYMBOL)
+std::vector<SymbolId> buildTerminalMap(const SymbolTable& from, const SymbolTable& to);
 
-size_t countTerminals(const std::vector<Symbol>& sentential);
+void translateWord(
+    const std::vector<SymbolId>& terminalMap,
+    const std::vector<SymbolId>& w,
+    std::vector<SymbolId>& out);
 
-std::vector<size_t> nonterminalPositions(const std::vector<Symbol>& sentential);
+RuleMap buildRuleMap(const Grammar& g);
 
 size_t countNonterminalsInProd(const std::vector<Symbol>& prod);
 
 size_t countTerminalsInProd(const std::vector<Symbol>& prod);
 
+size_t genRegime(size_t currentLen, size_t stepsUsed, const GenSettings& cfg);
+
+double alternativeWeight(const std::vector<Symbol>& prod, size_t nt, size_t tm, size_t regime, double expansionBias = 1.0);
+
 size_t chooseAlternativeIndex(
     const std::vector<std::vector<Symbol>>& alts,
     std::mt19937_64& rng,
@@ -86,24 +276,52 @@ size_t chooseAlternativeIndex(
     size_t stepsUsed,
     const GenSettings& cfg);
 
-std::optional<std::vector<std::string>> generateString(
-    const RuleMap& rm,
-    const std::string& startSymbol,
+CompiledRuleMap compileRuleMap(const RuleMap& rm, double expansionBias = 1.0);
+
+// rebuild only the alias tables of crm, for a new expansion bias
+void reweightRuleMap(CompiledRuleMap& crm, double expansionBias);
+
+size_t chooseCompiledAlternative(
+    const CompiledAlternatives& ca,
     std::mt19937_64& rng,
+    size_t currentLen,
+    size_t stepsUsed,
     const GenSettings& cfg);
 
-std::string joinTokens(const std::vector<std::string>& w);
+std::optional<std::vector<SymbolId>> generateString(
+    const CompiledRuleMap& crm,
+    SymbolId startSymbol,
+    std::mt19937_64& rng,
+    const GenSettings& cfg,
+    DerivationWorkspace& ws);
+
+std::string joinTokens(const SymbolTable& symbols, const std::vector<SymbolId>& w);
 
 DiffResult findCounterExample(
     const Grammar& g1,
-    const std::string& s1,
+    SymbolId s1,
     const CykIndex& idx1,
     const Grammar& g2,
-    const std::string& s2,
+    SymbolId s2,
     const CykIndex& idx2,
     size_t trials,
     uint64_t seed,
-    const GenSettings& cfg);
+    const GenSettings& cfg,
+    size_t threads);
+
+SearchTables buildSearchTables(const Grammar& g, SymbolId start, const CykIndex& idx, const GenSettings& cfg);
+
+// the same search on tables built beforehand; cfg.uniform must match the tables
+DiffResult findCounterExample(
+    const SearchTables& t1,
+    const SearchTables& t2,
+    const SearchBudget& budget,
+    uint64_t seed,
+    const GenSettings& cfg,
+    size_t threads);
+
+// peak resident memory of the process in bytes, 0 where it cannot be measured
+size_t peakResidentMemory();
 
 
 
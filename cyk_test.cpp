@@ -0,0 +1,102 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+/*
+ * checks that a CykWorkspace reaches steady state: once cykAcceptsBits has run on
+ * the longest input, further calls of any length up to it never grow the arena.
+ * every answer is also checked against the hash based cykAccepts. exits nonzero
+ * on the first failure.
+ */
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include "parser.h"
+#include "cnf.h"
+#include "cyk.h"
+
+constexpr size_t TEST_MAX_LENGTH = 96;
+constexpr size_t TEST_WORDS_PER_LENGTH = 4;
+constexpr uint64_t TEST_SEED = 1874592;
+
+static const char* const TEST_GRAMMAR =
+	"S -> S S | \"(\" S \")\" | \"a\" | A;\n"
+	"A -> \"b\" A \"a\" | epsilon;\n";
+
+static int failures = 0;
+
+static void check(bool ok, const std::string& what)
+{
+	if (ok)
+		return;
+	std::cerr << "FAIL: " << what << std::endl;
+	++failures;
+}
+
+// the first word of each length is a run of "a", always a member; the rest are random
+static std::vector<SymbolId> testWord(const std::vector<SymbolId>& alphabet, size_t n, size_t k, std::mt19937_64& rng)
+{
+	std::vector<SymbolId> w(n, alphabet[2]);
+	if (k != 0)
+		for (auto& t : w)
+			t = alphabet[rng() % alphabet.size()];
+	return w;
+}
+
+int main()
+{
+	Grammar g = Parser{ TEST_GRAMMAR }.parseGrammar();
+	std::vector<SymbolId> alphabet;
+	for (const char* name : { "(", ")", "a", "b" })
+		alphabet.push_back(g.symbols.findTerminal(name));
+	CNF(g);
+
+	const CykIndex idx = buildCykIndex(g);
+	const BitCykIndex bits = buildBitCykIndex(g, idx);
+	std::mt19937_64 rng(TEST_SEED);
+	CykWorkspace ws;
+
+	auto run = [&](size_t n) {
+		for (size_t k = 0; k < TEST_WORDS_PER_LENGTH; ++k)
+		{
+			const std::vector<SymbolId> w = testWord(alphabet, n, k, rng);
+			check(cykAcceptsBits(g, bits, g.start, w, ws) == cykAccepts(g, idx, g.start, w),
+				  "cykAcceptsBits disagrees with cykAccepts at length " + std::to_string(n));
+		}
+	};
+
+	// growing lengths may grow the arena, up to the first call at the maximum
+	for (size_t n = 1; n <= TEST_MAX_LENGTH; ++n)
+		run(n);
+	const size_t steady = ws.allocations;
+	check(steady > 0, "the workspace never allocated");
+
+	// after that, no length up to the maximum may allocate again, in any order
+	for (size_t n = TEST_MAX_LENGTH; n >= 1; --n)
+		run(n);
+	for (size_t n = 1; n <= TEST_MAX_LENGTH; n += 7)
+		run(n);
+	check(ws.allocations == steady,
+		  "workspace allocations grew from " + std::to_string(steady) + " to " + std::to_string(ws.allocations));
+
+	if (failures != 0)
+		return 1;
+	std::cout << "cyk_test: workspace steady after " << steady << " allocations" << std::endl;
+	return 0;
+}
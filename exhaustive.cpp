@@ -0,0 +1,263 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "exhaustive.h"
+#include <algorithm>
+#include <iterator>
+
+StringPool::StringPool()
+: offsets{ 0 },
+  index(0, Hash{ this }, Eq{ this })
+{
+}
+
+size_t StringPool::Hash::operator()(uint32_t id) const noexcept
+{
+    size_t h = pool->length(id);
+    const SymbolId* p = pool->data(id);
+    for (size_t i = 0; i < pool->length(id); ++i)
+    {
+        h ^= p[i] + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+    }
+    return h;
+}
+
+bool StringPool::Eq::operator()(uint32_t a, uint32_t b) const noexcept
+{
+    return pool->length(a) == pool->length(b)
+        && std::equal(pool->data(a), pool->data(a) + pool->length(a), pool->data(b));
+}
+
+/*
+ * the candidate is appended as if it were new, then looked up by that id.
+ * if an equal string already exists the candidate is dropped again.
+ */
+uint32_t StringPool::intern(const std::vector<SymbolId>& s)
+{
+    const uint32_t id = static_cast<uint32_t>(offsets.size() - 1);
+    symbols.insert(symbols.end(), s.begin(), s.end());
+    offsets.push_back(symbols.size());
+
+    auto [it, inserted] = index.insert(id);
+    if (!inserted)
+    {
+        offsets.pop_back();
+        symbols.resize(offsets.back());
+    }
+    return *it;
+}
+
+size_t StringPool::size() const
+{
+    return offsets.size() - 1;
+}
+
+size_t StringPool::length(uint32_t id) const
+{
+    return offsets[id + 1] - offsets[id];
+}
+
+const SymbolId* StringPool::data(uint32_t id) const
+{
+    return symbols.data() + offsets[id];
+}
+
+namespace
+{
+    /*
+     * the language slices of one CNF grammar: slices[A][n] is the sorted set of pool ids
+     * of the strings of length n that A derives. terminals are in the shared joint alphabet.
+     */
+    struct LanguageTable
+    {
+        bool startNullable = false;
+        SymbolId start = NO_SYMBOL;
+        std::vector<std::vector<SymbolId>> termProds;
+        std::vector<std::vector<std::pair<SymbolId, SymbolId>>> binProds;
+        std::vector<std::vector<std::vector<uint32_t>>> slices;
+    };
+
+    LanguageTable makeTable(const Grammar& g, SymbolId start, const std::vector<SymbolId>& toJoint)
+    {
+        LanguageTable lt;
+        const size_t nts = g.symbols.nonterminalCount();
+        lt.start = start;
+        lt.startNullable = g.acceptsEmpty(start);
+        lt.termProds.resize(nts);
+        lt.binProds.resize(nts);
+        lt.slices.resize(nts);
+
+        for (const auto& r : g.rules)
+        {
+            for (const auto& prod : r.rhs)
+            {
+                if (prod.size() == 1 && prod[0].isTerminal)
+                {
+                    if (prod[0].id != EPSILON_ID)
+                        lt.termProds[r.lhs].push_back(toJoint[prod[0].id]);
+                }
+                else if (prod.size() == 2 && !prod[0].isTerminal && !prod[1].isTerminal)
+                {
+                    lt.binProds[r.lhs].push_back({ prod[0].id, prod[1].id });
+                }
+            }
+        }
+
+        // slot 0 is never used, CNF nonterminals other than the start cannot derive epsilon
+        for (auto& s : lt.slices)
+            s.resize(1);
+
+        return lt;
+    }
+
+    // build slices[A][n] for every A, false if a limit was hit
+    bool extend(LanguageTable& lt, StringPool& pool, size_t n, const ExhaustiveLimits& limits,
+                size_t& concats, std::string& reason)
+    {
+        std::vector<SymbolId> buf;
+
+        for (size_t A = 0; A < lt.slices.size(); ++A)
+        {
+            std::vector<uint32_t> slice;
+
+            if (n == 1)
+            {
+                for (SymbolId t : lt.termProds[A])
+                    slice.push_back(pool.intern({ t }));
+            }
+            else
+            {
+                for (const auto& [B, C] : lt.binProds[A])
+                {
+                    for (size_t k = 1; k < n; ++k)
+                    {
+                        for (uint32_t left : lt.slices[B][k])
+                        {
+                            for (uint32_t right : lt.slices[C][n - k])
+                            {
+                                if (++concats > limits.maxConcats)
+                                {
+                                    reason = "concatenation limit reached";
+                                    return false;
+                                }
+
+                                buf.assign(pool.data(left), pool.data(left) + pool.length(left));
+                                buf.insert(buf.end(), pool.data(right), pool.data(right) + pool.length(right));
+                                slice.push_back(pool.intern(buf));
+
+                                if (pool.size() > limits.maxStrings)
+                                {
+                                    reason = "string limit reached";
+                                    return false;
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            std::sort(slice.begin(), slice.end());
+            slice.erase(std::unique(slice.begin(), slice.end()), slice.end());
+            lt.slices[A].push_back(std::move(slice));
+        }
+
+        return true;
+    }
+}
+
+ExhaustiveResult compareExhaustive(
+    const Grammar& g1,
+    SymbolId s1,
+    const Grammar& g2,
+    SymbolId s2,
+    size_t maxLen,
+    const ExhaustiveLimits& limits)
+{
+    ExhaustiveResult res;
+
+    // joint alphabet: grammar 1 ids as they are, grammar 2 only terminals appended after them
+    std::vector<std::string> jointNames;
+    std::vector<SymbolId> toJoint1(g1.symbols.terminalCount());
+    std::vector<SymbolId> toJoint2(g2.symbols.terminalCount());
+
+    for (SymbolId t = 0; t < g1.symbols.terminalCount(); ++t)
+    {
+        toJoint1[t] = t;
+        jointNames.push_back(g1.symbols.terminalName(t));
+    }
+    for (SymbolId t = 0; t < g2.symbols.terminalCount(); ++t)
+    {
+        SymbolId j = t == EPSILON_ID ? EPSILON_ID : g1.symbols.findTerminal(g2.symbols.terminalName(t));
+        if (j == NO_SYMBOL)
+        {
+            j = static_cast<SymbolId>(jointNames.size());
+            jointNames.push_back(g2.symbols.terminalName(t));
+        }
+        toJoint2[t] = j;
+    }
+
+    StringPool pool;
+    LanguageTable lt1 = makeTable(g1, s1, toJoint1);
+    LanguageTable lt2 = makeTable(g2, s2, toJoint2);
+
+    // length 0 is decided by the start symbols alone
+    res.sliceSizes1.push_back(lt1.startNullable ? 1 : 0);
+    res.sliceSizes2.push_back(lt2.startNullable ? 1 : 0);
+    if (lt1.startNullable != lt2.startNullable)
+    {
+        res.found = true;
+        res.g1Accepts = lt1.startNullable;
+        res.g2Accepts = lt2.startNullable;
+        return res;
+    }
+
+    size_t concats = 0;
+    for (size_t n = 1; n <= maxLen; ++n)
+    {
+        if (!extend(lt1, pool, n, limits, concats, res.reason)
+            || !extend(lt2, pool, n, limits, concats, res.reason))
+        {
+            res.gaveUp = true;
+            res.gaveUpAt = n;
+            return res;
+        }
+
+        const auto& a = lt1.slices[s1][n];
+        const auto& b = lt2.slices[s2][n];
+        res.sliceSizes1.push_back(a.size());
+        res.sliceSizes2.push_back(b.size());
+
+        if (a != b)
+        {
+            std::vector<uint32_t> diff;
+            std::set_symmetric_difference(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(diff));
+
+            const uint32_t w = diff.front();
+            for (size_t i = 0; i < pool.length(w); ++i)
+                res.witness += jointNames[pool.data(w)[i]];
+
+            res.found = true;
+            res.g1Accepts = std::binary_search(a.begin(), a.end(), w);
+            res.g2Accepts = !res.g1Accepts;
+            return res;
+        }
+
+        res.completedLength = n;
+    }
+
+    return res;
+}
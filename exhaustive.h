@@ -0,0 +1,97 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __EXHAUSTIVE_H__
+#define __EXHAUSTIVE_H__
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include "grammar.h"
+
+/*
+ * StringPool hash-conses terminal strings: every distinct string is stored once
+ * and named by a dense id, so language slices are just sorted id vectors and two
+ * slices can be compared without looking at the strings.
+ */
+class StringPool
+{
+public:
+    StringPool();
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    uint32_t intern(const std::vector<SymbolId>& s);
+    size_t size() const;
+    size_t length(uint32_t id) const;
+    const SymbolId* data(uint32_t id) const;
+
+private:
+    struct Hash
+    {
+        const StringPool* pool;
+        size_t operator()(uint32_t id) const noexcept;
+    };
+
+    struct Eq
+    {
+        const StringPool* pool;
+        bool operator()(uint32_t a, uint32_t b) const noexcept;
+    };
+
+    std::vector<SymbolId> symbols;
+    std::vector<size_t> offsets; // string i is symbols[offsets[i], offsets[i + 1])
+    std::unordered_set<uint32_t, Hash, Eq> index;
+};
+
+// the enumeration stops (and says so) once either limit is reached
+struct ExhaustiveLimits
+{
+    size_t maxStrings = 2000000; // distinct strings held in the pool
+    size_t maxConcats = 50000000; // concatenations tried while building slices
+};
+
+struct ExhaustiveResult
+{
+    bool found = false;
+    std::string witness;
+    bool g1Accepts = false;
+    bool g2Accepts = false;
+
+    size_t completedLength = 0; // every length up to this one was compared exactly
+    bool gaveUp = false;
+    size_t gaveUpAt = 0; // length that was being built when a limit was hit
+    std::string reason;
+
+    std::vector<size_t> sliceSizes1; // strings of each length, indexed by length
+    std::vector<size_t> sliceSizes2;
+};
+
+/*
+ * enumerate both languages (grammars in CNF) one length at a time up to maxLen and
+ * compare each length slice exactly. stops at the first length where they differ.
+ */
+ExhaustiveResult compareExhaustive(
+    const Grammar& g1,
+    SymbolId s1,
+    const Grammar& g2,
+    SymbolId s2,
+    size_t maxLen,
+    const ExhaustiveLimits& limits);
+
+#endif
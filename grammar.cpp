@@ -0,0 +1,62 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "grammar.h"
+#include "analysis.h"
+
+void Grammar::buildIndex()
+{
+	const size_t nts = symbols.nonterminalCount();
+	productions.clear();
+	prodLhs.clear();
+	prodTerminals.clear();
+	prodNonterminals.clear();
+	byLhs.assign(nts, {});
+	uses.assign(nts, {});
+
+	for (uint32_t ri = 0; ri < rules.size(); ++ri)
+	{
+		const Rule& r = rules[ri];
+		for (uint32_t ai = 0; ai < r.rhs.size(); ++ai)
+		{
+			const uint32_t p = static_cast<uint32_t>(productions.size());
+			size_t terminalCount = 0, nonterminalCount = 0;
+
+			for (const Symbol& s : r.rhs[ai])
+			{
+				if (!s.isTerminal)
+				{
+					uses[s.id].push_back(p);
+					++nonterminalCount;
+				}
+				else if (s.id != EPSILON_ID)
+				{
+					++terminalCount;
+				}
+			}
+
+			productions.push_back({ ri, ai });
+			prodLhs.push_back(r.lhs);
+			prodTerminals.push_back(terminalCount);
+			prodNonterminals.push_back(nonterminalCount);
+			byLhs[r.lhs].push_back(p);
+		}
+	}
+
+	startNullable = start < nts && nullableSet(*this)[start];
+}
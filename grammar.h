@@ -18,15 +18,54 @@
 #ifndef __GRAMMAR_H__
 #define __GRAMMAR_H__
 
+#include <cstdint>
 #include <unordered_set>
 #include "rule.h"
 
+/*
+ * ProductionRef names one alternative: rules[rule].rhs[alt]
+ */
+struct ProductionRef
+{
+	uint32_t rule;
+	uint32_t alt;
+};
+
 class Grammar
 {
 public:
+	SymbolTable symbols;
 	std::vector<Rule> rules;
-	std::unordered_set<std::string> terminals;
-	std::unordered_set<std::string> nonterminals;
+	std::unordered_set<SymbolId> terminals;
+	std::unordered_set<SymbolId> nonterminals;
+	SymbolId start = NO_SYMBOL;
+
+	/*
+	 * the index every analysis and CNF pass reads, filled in by buildIndex and stale
+	 * once rules change. productions are numbered in rule order; an lhs may head
+	 * several rules, and byLhs gathers all of its alternatives. a production is listed
+	 * in uses once per occurrence of the nonterminal.
+	 */
+	std::vector<ProductionRef> productions; // production number -> where it lives
+	std::vector<SymbolId> prodLhs;
+	std::vector<size_t> prodTerminals; // terminals in each production, epsilon not counted
+	std::vector<size_t> prodNonterminals; // nonterminal occurrences in each production
+	std::vector<std::vector<uint32_t>> byLhs; // nonterminal -> productions it heads
+	std::vector<std::vector<uint32_t>> uses; // nonterminal -> productions it occurs in
+	bool startNullable = false;
+
+	void buildIndex();
+
+	const std::vector<Symbol>& production(uint32_t p) const
+	{
+		return rules[productions[p].rule].rhs[productions[p].alt];
+	}
+
+	// whether s derives the empty string; exact for CNF, where only the start symbol can
+	bool acceptsEmpty(SymbolId s) const
+	{
+		return s == start && startNullable;
+	}
 };
 
 #endif
@@ -17,9 +17,15 @@
 
 #include "lexer.h"
 #include <cctype>
-#include <stdexcept>
 
-Lexer::Lexer(const std::string& input)
+SyntaxError::SyntaxError(size_t line, size_t column, const std::string& message)
+: std::runtime_error(message),
+  line(line),
+  column(column)
+{
+}
+
+Lexer::Lexer(std::string_view input)
 : pos(0),
   input(input),
   hasPeeked(false),
@@ -50,6 +56,26 @@ Token Lexer::peek()
 	return peekedToken;
 }
 
+void Lexer::error(size_t offset, const std::string& message) const
+{
+	// positions are only needed on failure, so they are worked out here instead of tracked per token
+	size_t line = 1, column = 1;
+	for (size_t i = 0; i < offset && i < input.size(); ++i)
+	{
+		if (input[i] == '\n')
+		{
+			++line;
+			column = 1;
+		}
+		else
+		{
+			++column;
+		}
+	}
+
+	throw SyntaxError(line, column, message);
+}
+
 Token Lexer::nextToken()
 {
 	// whitespace and newline
@@ -61,7 +87,7 @@ Token Lexer::nextToken()
 	// end of input
 	if (pos >= input.size())
 	{
-		return Token(TokenType::END_OF_FILE, "");
+		return Token(TokenType::END_OF_FILE, "", pos);
 	}
 
 	char c = input[pos];
@@ -71,7 +97,7 @@ Token Lexer::nextToken()
 	if (c == '-' && pos + 1 < input.size() && input[pos + 1] == '>')
 	{
 		pos += 2;
-		return Token(TokenType::ARROW, "->");
+		return Token(TokenType::ARROW, "->", pos - 2);
 	}
 
 	// alternation |
@@ -79,19 +105,20 @@ Token Lexer::nextToken()
 	if (c == '|') 
 	{
 		++pos;
-		return Token(TokenType::OR, "|");
+		return Token(TokenType::OR, "|", pos - 1);
 	}
 
 	// semicolon ;
 	if (c == ';')
 	{
 		++pos;
-		return Token(TokenType::SEMICOLON, ";");
+		return Token(TokenType::SEMICOLON, ";", pos - 1);
 	}
 
 	// string literal terminal
 	if (c == '"')
 	{
+		const size_t quote = pos;
 		++pos;
 		size_t start = pos;
 		while (pos < input.size() && input[pos] != '"')
@@ -100,11 +127,11 @@ Token Lexer::nextToken()
 		}
 
 		if (pos >= input.size())
-			throw std::runtime_error("Unterminated string literal");
+			error(quote, "unterminated string literal");
 
-		std::string lexeme = input.substr(start, pos - start);
+		std::string_view lexeme = input.substr(start, pos - start);
 		++pos;
-		return Token(TokenType::STRING, lexeme);
+		return Token(TokenType::STRING, lexeme, quote);
 	}
 	
 	// nonterminals and epsilon
@@ -118,15 +145,16 @@ Token Lexer::nextToken()
 			++pos;
 		}
 
-		std::string lexeme = input.substr(start, pos - start);
+		std::string_view lexeme = input.substr(start, pos - start);
 
 		if (lexeme == "epsilon")
-			return Token(TokenType::EPSILON, lexeme);
+			return Token(TokenType::EPSILON, lexeme, start);
 
-		return Token(TokenType::ID, lexeme);
+		return Token(TokenType::ID, lexeme, start);
 	}
 
-	std::string msg = "Unexpected character in input: ";
+	std::string msg = "unexpected character '";
 	msg.push_back(c);
-	throw std::runtime_error(msg);
+	msg += "'";
+	error(pos, msg);
 }
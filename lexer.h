@@ -19,18 +19,36 @@
 #define __LEXER_H__
 
 #include <string>
+#include <string_view>
+#include <stdexcept>
 #include "token.h"
 
+/*
+ * thrown by the lexer and the parser. line and column are 1-based, columns
+ * count bytes
+ */
+class SyntaxError : public std::runtime_error
+{
+public:
+	SyntaxError(size_t line, size_t column, const std::string& message);
+	size_t line;
+	size_t column;
+};
+
 class Lexer 
 {
 public:
-	Lexer(const std::string& input);
+	// the lexer reads input in place; the caller keeps it alive until parsing is done
+	Lexer(std::string_view input);
 	Token getToken();
 	Token peek();
 
+	// throw a SyntaxError located at the given input offset
+	[[noreturn]] void error(size_t offset, const std::string& message) const;
+
 private:
 	size_t pos;
-	std::string input;
+	std::string_view input;
 
 	bool hasPeeked;
 	Token peekedToken;
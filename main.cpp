@@ -15,774 +15,611 @@
  *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <fstream>
 #include <utility>
 #include <iostream>
+#include <fstream>
 #include <string>
-#include <iterator>
 #include <unordered_set>
 #include <unordered_map>
-#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <thread>
 #include "parser.h"
 #include "rule.h"
 #include "cyk.h"
-
-bool isUnitProduction(const std::vector<Symbol>& prod)
+#include "exhaustive.h"
+#include "shortest.h"
+#include "minimize.h"
+#include "cnf.h"
+#include "cache.h"
+#include "source.h"
+#include "corpus.h"
+#include "stats.h"
+
+// command line options
+struct Options
 {
-	return prod.size() == 1 && !prod[0].isTerminal;
-}
-
-bool isEpsilonProduction(const std::vector<Symbol>& prod)
+	size_t threads = 1;
+	size_t maxSteps = 200;
+	bool uniform = false;
+	size_t exhaustiveUpto = 0; // 0 runs the random search instead
+	size_t shortestUpto = 0;
+	bool cache = true;
+	bool matrix = false; // compare every pair of two or more grammars
+	std::string checkFile; // corpus to check line by line instead of comparing
+	Tokenizer tokenizer = Tokenizer::Chars;
+	bool stats = false; // print the hot path counters as JSON at the end
+	size_t trials = 0; // per direction, 0 for the default (unlimited under a time budget)
+	uint64_t seed = 1874592;
+	double timeBudget = 0.0; // seconds per search, 0 for none
+	size_t maxMemory = 0; // bytes, 0 for none
+	bool adaptive = false; // retune the generator during the search
+	std::vector<std::string> files;
+};
+
+// parse a count of at least minimum for an option, false if it is missing or malformed
+bool parseCount(int argc, char* argv[], int& i, size_t& out, size_t minimum = 1)
 {
-	return prod.size() == 1 && prod[0].isTerminal && prod[0].name == "epsilon";
-}
+	if (i + 1 >= argc)
+		return false;
 
-std::string altKey(const std::vector<Symbol>& alt)
-{
-	std::string k;
-	k.reserve(alt.size() * 8);
-	for (const auto& s : alt)
+	try
 	{
-		k += (s.isTerminal ? "T:" : "N:");
-		k += s.name;
-		k += "|";
+		size_t used = 0;
+		std::string text = argv[++i];
+		unsigned long long v = std::stoull(text, &used);
+		if (used != text.size() || v < minimum)
+			return false;
+		out = static_cast<size_t>(v);
+		return true;
 	}
-	return k;
-}
-
-void rebuildSymbolSets(Grammar& g)
-{
-	g.terminals.clear();
-	g.nonterminals.clear();
-
-	for (const auto& rule : g.rules)
+	catch (const std::exception&)
 	{
-		g.nonterminals.insert(rule.lhs);
-
-		for (const auto& prod : rule.rhs)
-		{
-			for (const auto& symbol : prod)
-			{
-				if (symbol.isTerminal)
-				{
-					if (symbol.name != "epsilon")
-						g.terminals.insert(symbol.name);
-				}
-				else
-					g.nonterminals.insert(symbol.name);
-			}
-		}
+		return false;
 	}
 }
 
-std::unordered_map<std::string, size_t> buildRuleIndex(const Grammar& g)
+// parse a positive number of seconds, such as 30 or 2.5
+bool parseSeconds(int argc, char* argv[], int& i, double& out)
 {
-	std::unordered_map<std::string, size_t> idx;
+	if (i + 1 >= argc)
+		return false;
 
-	for (size_t i = 0; i < g.rules.size(); ++i)
+	try
 	{
-		idx[g.rules[i].lhs] = i;
+		size_t used = 0;
+		std::string text = argv[++i];
+		double v = std::stod(text, &used);
+		if (used != text.size() || !(v > 0.0))
+			return false;
+		out = v;
+		return true;
 	}
-	return idx;
-}
-
-
-std::string prodKey(const std::vector<Symbol>& prod)
-{
-	std::ostringstream oss;
-	for (auto& s : prod)
+	catch (const std::exception&)
 	{
-		oss << (s.isTerminal ? "T:" : "N:") << s.name << "|"; 
+		return false;
 	}
-
-	return oss.str();
-
-}
-
-void buildInitialNullables(const Grammar& g, std::unordered_set<std::string>& nullable)
-{
-	for (auto& r : g.rules)
-	{
-		for (auto& prod : r.rhs)
-		{
-			if (prod.size() == 1 && prod[0].name == "epsilon")
-			{
-				nullable.insert(r.lhs);
-			}
-		}	
-	}  
 }
 
-// breadth first search to compute unit closure
-std::unordered_set<std::string> unitClosure(
-	const Grammar& g,
-	const std::unordered_map<std::string, size_t>& idx,
-	const std::string& start)
+// parse a positive size in bytes, optionally with a K, M or G suffix (powers of 1024)
+bool parseBytes(int argc, char* argv[], int& i, size_t& out)
 {
-	std::unordered_set<std::string> seen;
-	std::vector<std::string> q;
-	seen.insert(start);
-	q.push_back(start);
+	if (i + 1 >= argc)
+		return false;
 
-	while (!q.empty())
+	try
 	{
-		std::string a = q.back();
-		q.pop_back();
-
-		auto it = idx.find(a);
-		if (it == idx.end())
-			continue;
-
-		const Rule& r = g.rules[it->second];
-		for (const auto& prod : r.rhs)
+		size_t used = 0;
+		std::string text = argv[++i];
+		unsigned long long v = std::stoull(text, &used);
+		size_t shift = 0;
+		if (used + 1 == text.size())
 		{
-			if (isUnitProduction(prod))
+			switch (text.back())
 			{
-				const std::string& b = prod[0].name;
-				if (seen.insert(b).second)
-					q.push_back(b);
+			case 'K': case 'k': shift = 10; break;
+			case 'M': case 'm': shift = 20; break;
+			case 'G': case 'g': shift = 30; break;
+			default: return false;
 			}
 		}
+		else if (used != text.size())
+		{
+			return false;
+		}
+		if (v == 0 || v > (SIZE_MAX >> shift))
+			return false;
+		out = static_cast<size_t>(v) << shift;
+		return true;
 	}
-
-	return seen;
-}
-
-
-void removeUnitProductions(Grammar& g)
-{
-	auto idx = buildRuleIndex(g);
-	std::unordered_map<std::string, std::unordered_set<std::string>> closureMap;
-	closureMap.reserve(g.rules.size());
-
-	for (const auto& r : g.rules)
+	catch (const std::exception&)
 	{
-		closureMap[r.lhs] = unitClosure(g, idx, r.lhs);
+		return false;
 	}
+}
 
-	for (auto& rA : g.rules)
+bool parseOptions(int argc, char* argv[], Options& opts)
+{
+	for (int i = 1; i < argc; ++i)
 	{
-		std::vector<std::vector<Symbol>> newRhs;
-		std::unordered_set<std::string> seenAlt;
-
-		for (const auto& B : closureMap[rA.lhs])
+		std::string arg = argv[i];
+		if (arg == "--threads")
 		{
-			auto it = idx.find(B);
-			if (it == idx.end())
-				continue;
-
-			const Rule& rB = g.rules[it->second];
-
-			for (const auto& prod : rB.rhs)
+			if (!parseCount(argc, argv, i, opts.threads))
+				return false;
+		}
+		else if (arg == "--max-steps")
+		{
+			if (!parseCount(argc, argv, i, opts.maxSteps))
+				return false;
+		}
+		else if (arg == "--exhaustive-upto")
+		{
+			if (!parseCount(argc, argv, i, opts.exhaustiveUpto))
+				return false;
+		}
+		else if (arg == "--shortest-upto")
+		{
+			if (!parseCount(argc, argv, i, opts.shortestUpto))
+				return false;
+		}
+		else if (arg == "--trials")
+		{
+			if (!parseCount(argc, argv, i, opts.trials))
+				return false;
+		}
+		else if (arg == "--seed")
+		{
+			size_t seed = 0;
+			if (!parseCount(argc, argv, i, seed, 0))
+				return false;
+			opts.seed = seed;
+		}
+		else if (arg == "--time-budget")
+		{
+			if (!parseSeconds(argc, argv, i, opts.timeBudget))
+				return false;
+		}
+		else if (arg == "--max-memory")
+		{
+			if (!parseBytes(argc, argv, i, opts.maxMemory))
+				return false;
+		}
+		else if (arg == "--adaptive")
+		{
+			opts.adaptive = true;
+		}
+		else if (arg == "--uniform")
+		{
+			opts.uniform = true;
+		}
+		else if (arg == "--no-cache")
+		{
+			opts.cache = false;
+		}
+		else if (arg == "--matrix")
+		{
+			opts.matrix = true;
+		}
+		else if (arg == "--check")
+		{
+			if (i + 1 >= argc)
+				return false;
+			opts.checkFile = argv[++i];
+		}
+		else if (arg == "--stats")
+		{
+			// without the counters compiled in there is nothing to report
+			if (!STATS_COMPILED)
 			{
-				if (isUnitProduction(prod))
-					continue;
-
-				std::string key = altKey(prod);
-				if (seenAlt.insert(key).second)
-					newRhs.push_back(prod);
+				std::cerr << "Error: --stats needs a build with STATS=1" << std::endl;
+				return false;
 			}
+			opts.stats = true;
 		}
-		rA.rhs = std::move(newRhs);
-	}
-}
-
-std::unordered_set<std::string> calcNullableSet(const Grammar& g)
-{
-	std::unordered_set<std::string> nullable;
-	
-	buildInitialNullables(g, nullable);
-
-	bool changed = true;
-	while (changed) 
-	{
-		changed = false;
-		for (auto& r : g.rules) 
+		else if (arg == "--tokenizer")
 		{
-			if (nullable.find(r.lhs) == nullable.end()) 
-			{
-				for (auto& prod : r.rhs) 
-				{
-					bool allNullable = true;
-					for (auto& symbol : prod)
-					{
-						if (symbol.isTerminal && symbol.name != "epsilon")
-						{
-							allNullable = false;
-							break;
-						}
-						else if (symbol.name == "epsilon")
-						{
-							std::cerr << "epsilon production should appear by itself" << std::endl;
-							exit(1);
-						}
-
-						if (nullable.find(symbol.name) == nullable.end())
-						{
-							allNullable = false;
-							break;
-						}
-					}
-
-					if (allNullable && nullable.find(r.lhs) == nullable.end())
-					{
-						nullable.insert(r.lhs);
-						changed = true;
-						break;
-					}
-				}
-			}	
+			if (i + 1 >= argc)
+				return false;
+			std::string kind = argv[++i];
+			if (kind == "chars")
+				opts.tokenizer = Tokenizer::Chars;
+			else if (kind == "words")
+				opts.tokenizer = Tokenizer::Words;
+			else
+				return false;
+		}
+		else if (arg.rfind("--", 0) == 0)
+		{
+			return false;
+		}
+		else
+		{
+			opts.files.push_back(arg);
 		}
 	}
 
-	return nullable;
-}
+	// uniform sampling has no settings to tune
+	if (opts.adaptive && opts.uniform)
+		return false;
 
-std::string addFreshStartSymbol(Grammar& g, const std::string& oldStart)
-{
-	auto freshStartName = [](const Grammar& g, const std::string& base = "S0") -> std::string
-	{
-		if (g.nonterminals.find(base) == g.nonterminals.end())
-			return base;
-		for (int i = 1; ; ++i)
-		{
-			std::string candidate = base + "_" + std::to_string(i);
-			if (g.nonterminals.find(candidate) == g.nonterminals.end())
-				return candidate; 
-		}
-	};
+	// the two enumerations are separate modes, and neither draws random strings
+	const bool enumerating = opts.exhaustiveUpto > 0 || opts.shortestUpto > 0;
+	if (opts.exhaustiveUpto > 0 && opts.shortestUpto > 0)
+		return false;
+	if (enumerating && (opts.uniform || opts.adaptive))
+		return false;
 
-	auto newStart = freshStartName(g, "S0");
-	
-	Rule r;
-	
-	r.lhs = newStart;
+	// a corpus is checked against one grammar, or two to list where they differ
+	if (!opts.checkFile.empty())
+		return (opts.files.size() == 1 || opts.files.size() == 2) && !opts.matrix && !enumerating;
+
+	// the matrix runs the random search only
+	if (opts.matrix)
+		return opts.files.size() >= 2 && !enumerating;
 
-	Symbol s;
-	s.isTerminal = false;
-	s.name = oldStart;
+	return opts.files.size() == 2;
+}
 
-	r.rhs.push_back(std::vector<Symbol>{s});
-	g.rules.insert(g.rules.begin(), r);
-	g.nonterminals.insert(newStart);
+// trials per direction of a random search without --trials or --time-budget
+constexpr size_t SEARCH_TRIALS = 5000;
 
-	return newStart;
+// without --trials, a time budget alone lets the search run until it is spent
+SearchBudget searchBudget(const Options& opts)
+{
+	SearchBudget budget;
+	if (opts.trials > 0)
+		budget.trials = opts.trials;
+	else
+		budget.trials = opts.timeBudget > 0.0 ? SIZE_MAX : SEARCH_TRIALS;
+	budget.seconds = opts.timeBudget;
+	budget.maxMemory = opts.maxMemory;
+	return budget;
 }
 
-bool startDerivesEpsilon(const std::unordered_set<std::string>& nullable, const std::string& startSymbol)
+// one line on how much work a search did and why it stopped
+void printSearchWork(const DiffResult& res)
 {
-	return nullable.find(startSymbol) != nullable.end();
+	std::cout << "Search stopped (" << searchStopName(res.stop) << ") after " << res.trials << " trials, "
+			  << res.tested << " distinct strings tested, " << std::round(res.seconds * 1000.0) / 1000.0 << " s, peak memory "
+			  << res.peakMemory / (1024 * 1024) << " MB\n";
 }
 
-void removeEpsilonProductions(Grammar& g, const std::string& startSymbol)
+void printTuningLog(const DiffResult& res, const char* indent)
 {
-	// calculate the nullable set
-	std::unordered_set nullable = calcNullableSet(g);
-	bool keepStartEpsilon = startDerivesEpsilon(nullable, startSymbol);
+	for (const auto& line : res.tuningLog)
+		std::cout << indent << "Tuning " << line << "\n";
+}
 
-	for (auto& rule : g.rules)
-	{
-		// declare a set to build the new alts
-		std::vector<std::vector<Symbol>> newAlts;
-		std::unordered_set<std::string> seen; // keep track of what's already been seen
+GenSettings searchSettings(const Options& opts)
+{
+	GenSettings cfg;
+	cfg.maxSteps = opts.maxSteps;
+	cfg.maxLen = 40;
+	cfg.targetMin = 1;
+	cfg.targetMax = 20;
+	cfg.uniform = opts.uniform;
+	cfg.adaptive = opts.adaptive;
+	return cfg;
+}
 
-		for (auto& prod : rule.rhs)
-		{
-			// skip explicit epsilon productions for now
-			if (prod.size() == 1 && prod[0].name == "epsilon")
-				continue;
-			
-			// epsilon should not appear mixed with other symbols in the production
-			for (auto& symbol : prod)
-			{
-				if (symbol.name == "epsilon")
-				{
-					std::cerr << "Epsilon symbol appeard in non-epsilon production" << std::endl;
-					exit(1);
-				}
-			}
+void testGrammars(const CompiledGrammar& c1, const CompiledGrammar& c2, const Options& opts)
+{
+	const Grammar& g1 = c1.grammar;
+	const Grammar& g2 = c2.grammar;
+	const CykIndex& idx1 = c1.index;
+	const CykIndex& idx2 = c2.index;
 
-			// find nullable non-terminal positions
-			std::vector<size_t> nullablePositions;
+	const GenSettings cfg = searchSettings(opts);
 
-			for (size_t i = 0; i < prod.size(); ++i)
-			{
-				const auto& symbol = prod[i];
-				if (!symbol.isTerminal && nullable.find(symbol.name) != nullable.end())
-					nullablePositions.push_back(i);
-			}
+	const SearchTables t1 = buildSearchTables(g1, g1.start, idx1, cfg);
+	const SearchTables t2 = buildSearchTables(g2, g2.start, idx2, cfg);
 
-			// include the original production
-			if (seen.insert(prodKey(prod)).second)
-				newAlts.push_back(prod);
-			
-			// generate productions by deleting any subset of nullable positions
-			// iterate masks 1..(2^m - 1)
-			const size_t m = nullablePositions.size();
-			if (m >= sizeof(size_t) * 8)
-			{
-				std::cerr << "Too many nullable symbols for bitmask\n";
-				exit(1);
-			}
-			const size_t totalMasks = 1 << m;
-
-			for (size_t mask = 1; mask < totalMasks; ++mask)
-			{
-				std::vector<Symbol> candidate;
-				candidate.reserve(prod.size());
-				for (size_t i = 0; i < prod.size(); ++i)
-				{
-					bool deleteThis = false;
-					// check if i is among nullablePositions selected by mask
-					for (size_t j = 0; j < m; ++j)
-					{
-						if (nullablePositions[j] == i && (mask & (size_t{1} << j)))
-						{
-							deleteThis = true;
-							break;
-						}
-					}
-					if (!deleteThis) candidate.push_back(prod[i]);
-				}
-				
-				// if we delete everything, this is epsilon
-				if (candidate.empty())
-				{
-					if (keepStartEpsilon && rule.lhs == startSymbol)
-					{
-						std::vector<Symbol> eps{Symbol{true, "epsilon"}};
-						if (seen.insert(prodKey(eps)).second)
-							newAlts.push_back(eps);
-					}
-					continue;
-				}
-				
-				if (seen.insert(prodKey(candidate)).second)
-					newAlts.push_back(candidate);
-			}
-		}
+	std::cout << "Attempting to find equivalence counterexamples...\n";
+	auto res = findCounterExample(t1, t2, searchBudget(opts), opts.seed, cfg, opts.threads);
+	printTuningLog(res, "");
+	printSearchWork(res);
 
-		// if rule is start symbol, keep epsilon
-		if (keepStartEpsilon && rule.lhs == startSymbol)
-		{
-			std::vector<Symbol> eps{Symbol{true, "epsilon"}};
-			std::string key = prodKey(eps);
-			bool exists = false;
-			for (auto& alt : newAlts)
-			{
-				if (prodKey(alt) == key)
-				{
-					exists = true;
-					break;
-				}
-			}
-			if (!exists) 
-				newAlts.push_back(eps);
-		}
+	if (res.found)
+	{
+		std::cout << "Grammars are NOT equivalent.\n";
+		std::cout << "Witness: " << res.witness << "\n";
+		std::cout << "G1 accepts: " << res.g1Accepts << "\n";
+		std::cout << "G2 accepts: " << res.g2Accepts << "\n";
 
-		// replace rhs with newAlts
-		rule.rhs = std::move(newAlts);
-	} 
+		std::cout << "Minimizing witness...\n";
+		CykWorkspace ws;
+		auto min = minimizeCounterExample(g1, g1.start, t1.bits, g2, g2.start, t2.bits, res.tokens, ws);
+		std::cout << "Minimized witness: " << min.witness << "\n";
+		std::cout << "G1 accepts: " << min.g1Accepts << "\n";
+		std::cout << "G2 accepts: " << min.g2Accepts << "\n";
+		std::cout << "Reduction steps: " << min.steps << ", candidates: " << min.candidates
+				  << ", CYK calls: " << min.cykCalls << "\n";
+	}
+	else
+	{
+		std::cout << "No counterexample found in budget.\n";
+	}
 }
 
 
-
-std::unordered_set<std::string> computeGenerating(const Grammar& g)
+void compareUpTo(const Grammar& g1, const Grammar& g2, size_t maxLen)
 {
-	std::unordered_set<std::string> GEN;
-	bool changed = true;
-	while (changed)
+	std::cout << "Enumerating every string up to length " << maxLen << "...\n";
+	auto res = compareExhaustive(g1, g1.start, g2, g2.start, maxLen, ExhaustiveLimits{});
+
+	for (size_t n = 0; n < res.sliceSizes1.size(); ++n)
 	{
-		changed = false;
-		for (const Rule& r : g.rules)
-		{
-			for (const auto& prod : r.rhs)
-			{
-				bool ok = true;
-
-				if (prod.size() == 1 && prod[0].isTerminal && prod[0].name == "epsilon")
-				{
-					ok = true;
-				}
-				else
-				{
-					for (const Symbol& s : prod)
-					{
-						if (s.isTerminal)
-							continue;
-
-						if (!GEN.count(s.name))
-						{
-							ok = false;
-							break;
-						}
-					}
-				}
-				if (ok)
-				{
-					if (GEN.insert(r.lhs).second)
-						changed = true;
-					break;
-				}
-			}
-		}
+		std::cout << "Length " << n << ": " << res.sliceSizes1[n] << " strings in G1, "
+				  << res.sliceSizes2[n] << " strings in G2\n";
 	}
-	return GEN;
-}
 
-void removeNonGenerating(Grammar& g, const std::unordered_set<std::string>& GEN)
-{
-	std::vector<Rule> newRules;
-	for (const Rule& r : g.rules)
+	if (res.found)
 	{
-		if (!GEN.count(r.lhs))
-			continue;
-
-		Rule nr;
-		nr.lhs = r.lhs;
-
-		for (const auto& prod : r.rhs)
-		{
-			bool ok = true;
-			if (!(prod.size() == 1 && prod[0].isTerminal && prod[0].name == "epsilon"))
-			{
-				for (const Symbol& s : prod)
-				{
-					if (!s.isTerminal && !GEN.count(s.name))
-					{
-						ok = false;
-						break;
-					}
-				}
-			}
-			if (ok)
-				nr.rhs.push_back(prod);
-		}
-
-		if (!nr.rhs.empty())
-			newRules.push_back(std::move(nr));
+		std::cout << "Grammars are NOT equivalent.\n";
+		std::cout << "Witness: " << res.witness << "\n";
+		std::cout << "G1 accepts: " << res.g1Accepts << "\n";
+		std::cout << "G2 accepts: " << res.g2Accepts << "\n";
 	}
-
-	g.rules = std::move(newRules);
-}
-
-std::unordered_set<std::string> computeReachable(const Grammar& g, const std::string& start)
-{
-	std::unordered_set<std::string> REACH;
-	std::vector<std::string> stack;
-
-	REACH.insert(start);
-	stack.push_back(start);
-
-	std::unordered_map<std::string, const Rule*> idx;
-	for (const Rule& r : g.rules)
+	else if (res.gaveUp)
 	{
-		idx[r.lhs] = &r;
+		std::cout << "Gave up while enumerating length " << res.gaveUpAt << " (" << res.reason << ").\n";
+		std::cout << "The languages agree on every string of length <= " << res.completedLength << ".\n";
 	}
-
-	while (!stack.empty())
+	else
 	{
-		std::string A = stack.back();
-		stack.pop_back();
-		auto it = idx.find(A);
-		if (it == idx.end())
-			continue;
-
-		for (const auto& prod : it->second->rhs)
-		{
-			for (const Symbol& s : prod)
-			{
-				if (!s.isTerminal && REACH.insert(s.name).second)
-					stack.push_back(s.name);
-			}
-		}
+		std::cout << "The languages agree on every string of length <= " << maxLen << ".\n";
 	}
-
-	return REACH;
 }
 
-void removeUnreachable(Grammar& g, const std::unordered_set<std::string>& REACH)
+
+void findShortest(const CompiledGrammar& c1, const CompiledGrammar& c2, size_t maxLen)
 {
-	std::vector<Rule> newRules;
-	for (const Rule& r : g.rules)
-	{
-		if (!REACH.count(r.lhs))
-			continue;
+	const Grammar& g1 = c1.grammar;
+	const Grammar& g2 = c2.grammar;
 
-		Rule nr;
-		nr.lhs = r.lhs;
+	std::cout << "Searching for a shortest counterexample up to length " << maxLen << "...\n";
+	auto res = findShortestCounterExample(g1, g1.start, c1.index,
+										  g2, g2.start, c2.index,
+										  maxLen, ShortestLimits{});
 
-		for (const auto& prod : r.rhs)
-		{
-			bool ok = true;
-			for (const Symbol& s : prod)
-			{
-				if (!s.isTerminal && !REACH.count(s.name))
-				{
-					ok = false;
-					break;
-				}
-			}
-			if (ok)
-				nr.rhs.push_back(prod);
-		}
+	std::cout << "Strings checked: " << res.stringsChecked << "\n";
 
-		if (!nr.rhs.empty())
-			newRules.push_back(std::move(nr));
+	if (res.found)
+	{
+		std::cout << "Grammars are NOT equivalent.\n";
+		std::cout << "Shortest witness: " << res.witness << "\n";
+		std::cout << "G1 accepts: " << res.g1Accepts << "\n";
+		std::cout << "G2 accepts: " << res.g2Accepts << "\n";
+	}
+	else if (res.gaveUp)
+	{
+		std::cout << "Gave up at length " << res.gaveUpAt << " (" << res.reason << ").\n";
+		std::cout << "No counterexample of length <= " << res.completedLength << " exists.\n";
+	}
+	else
+	{
+		std::cout << "No counterexample of length <= " << maxLen << " exists.\n";
 	}
-
-	g.rules = std::move(newRules);
 }
 
-void removeUselessSymbols(Grammar& g, const std::string& startSymbol)
-{
-	auto GEN = computeGenerating(g);
-	removeNonGenerating(g, GEN);
-
-	auto REACH = computeReachable(g, startSymbol);
-	removeUnreachable(g, REACH);
-
-	rebuildSymbolSets(g);
-}
 
-void printSymbols(const Grammar& g)
+/*
+ * outcome of one pair in the matrix. equivalent only means the search found no
+ * counterexample
+ */
+struct PairResult
 {
-	std::cout << "Nonterminals:\n";
-	for (const auto& nt : g.nonterminals)
-		std::cout << " " << nt << "\n";
-
-	std::cout << "Terminals:\n";
-	for (const auto& t : g.terminals)
-		std::cout << " " << t << "\n";
-}
+	size_t a = 0;
+	size_t b = 0;
+	DiffResult diff;
+	MinimizeResult min;
+};
 
-std::string makeFreshNonterminal(const Grammar& g, const std::string& base)
+size_t findClass(std::vector<size_t>& parent, size_t x)
 {
-	if (g.nonterminals.find(base) == g.nonterminals.end())
-		return base;
-
-	for (int i = 1; ; ++i)
+	while (parent[x] != x)
 	{
-		std::string cand = base + "_" + std::to_string(i);
-		if (g.nonterminals.find(cand) == g.nonterminals.end())
-			return cand;
+		parent[x] = parent[parent[x]];
+		x = parent[x];
 	}
+	return x;
 }
 
-std::string sanitize(const std::string& t)
+/*
+ * compare every pair of grammars. each grammar already has its CNF and CYK index
+ * from compileGrammar and gets its search tables once here, so a pair only costs
+ * its search. pairs are handed out to opts.threads workers, each running one
+ * single-threaded search at a time, and reported in pair order afterwards.
+ * grammars are grouped into classes by the pairs with no counterexample; since
+ * that is only evidence, a class that still contains a differing pair is flagged.
+ */
+void compareMatrix(const std::vector<CompiledGrammar>& grammars, const std::vector<std::string>& names, const Options& opts)
 {
-	std::string out;
-	for (unsigned char c : t)
+	const size_t n = grammars.size();
+	const GenSettings cfg = searchSettings(opts);
+	const SearchBudget budget = searchBudget(opts);
+
+	std::cout << "Building search tables...\n";
+	std::vector<SearchTables> tables;
+	tables.reserve(n);
+	for (const auto& cg : grammars)
+		tables.push_back(buildSearchTables(cg.grammar, cg.grammar.start, cg.index, cfg));
+
+	std::vector<PairResult> pairs;
+	pairs.reserve(n * (n - 1) / 2);
+	for (size_t a = 0; a < n; ++a)
 	{
-		if (std::isalnum(c))
-			out.push_back((char)c);
-		else
-			out.push_back('_');
+		for (size_t b = a + 1; b < n; ++b)
+		{
+			PairResult p;
+			p.a = a;
+			p.b = b;
+			pairs.push_back(std::move(p));
+		}
 	}
 
-	if (out.empty())
-		out = "tok";
-	return out;
-}
-
-
-void eliminateTerminalsFromLong(Grammar& g)
-{
-	std::unordered_map<std::string, std::string> termToNT;
-
-	std::vector<Rule> newRules;
+	std::cout << "Comparing " << n << " grammars (" << pairs.size() << " pairs)...\n";
 
-	for (auto& r : g.rules)
+	std::atomic<size_t> next{ 0 };
+	auto runWorker = [&]()
 	{
-		for (auto& prod : r.rhs)
+		StatsScope stats;
+		CykWorkspace ws;
+		for (size_t i = next++; i < pairs.size(); i = next++)
 		{
-			if (isEpsilonProduction(prod))
-				continue;
-
-			if (prod.size() < 2)
-				continue;
-
-			for (auto& symbol : prod)
+			PairResult& p = pairs[i];
+			p.diff = findCounterExample(tables[p.a], tables[p.b], budget, opts.seed, cfg, 1);
+			if (p.diff.found)
 			{
-				if (!symbol.isTerminal)
-					continue;
-
-				if (symbol.name == "epsilon")
-				{
-					std::cerr << "epsilon appears in a long RHS production" << std::endl;
-					exit(1);
-				}
-
-				auto it = termToNT.find(symbol.name);
-				if (it == termToNT.end())
-				{
-					std::string base = "T_" + sanitize(symbol.name);
-					std::string helper = makeFreshNonterminal(g, base);
-					termToNT[symbol.name] = helper;
-
-
-					Rule tr;
-					tr.lhs = helper;
-					Symbol termSym;
-					termSym.isTerminal = true;
-					termSym.name = symbol.name;
-
-					tr.rhs.push_back(std::vector<Symbol>{ termSym });
-					newRules.push_back(tr);
-
-					g.nonterminals.insert(helper);
-					it = termToNT.find(symbol.name);
-				}
-
-				symbol.isTerminal = false;
-				symbol.name = it->second;
+				const SearchTables& ta = tables[p.a];
+				const SearchTables& tb = tables[p.b];
+				p.min = minimizeCounterExample(*ta.grammar, ta.start, ta.bits,
+											   *tb.grammar, tb.start, tb.bits, p.diff.tokens, ws);
 			}
 		}
-	}
-
-	for (auto& nr : newRules)
-		g.rules.push_back(std::move(nr));
-
-	rebuildSymbolSets(g);
-}
+	};
 
+	{
+		const size_t threads = std::min(std::max<size_t>(opts.threads, 1), std::max<size_t>(pairs.size(), 1));
+		std::vector<std::jthread> pool;
+		pool.reserve(threads);
+		for (size_t k = 0; k < threads; ++k)
+			pool.emplace_back(runWorker);
+	}
 
-void binarizeRules(Grammar& g)
-{
-	std::vector<Rule> extraRules;
-	extraRules.reserve(64);
+	std::vector<size_t> parent(n);
+	for (size_t i = 0; i < n; ++i)
+		parent[i] = i;
 
-	for (auto& r : g.rules)
+	for (const auto& p : pairs)
 	{
-		std::vector<std::vector<Symbol>> newRhs;
-		newRhs.reserve(r.rhs.size());
-
-		for (const auto& prod : r.rhs)
+		std::cout << names[p.a] << " vs " << names[p.b] << ": ";
+		if (p.diff.found)
 		{
-			if (prod.size() <= 2)
-			{
-				newRhs.push_back(prod);
-				continue;
-			}
-
-			Symbol first = prod[0];
-			std::string prevHelper = makeFreshNonterminal(g, "X");
-
-			g.nonterminals.insert(prevHelper);
-
-			newRhs.push_back(std::vector<Symbol>{ first, Symbol{ false, prevHelper } });
-
-			for (size_t i = 1; i < prod.size(); ++i)
-			{
-				if (i == prod.size() - 2)
-				{
-					Rule rr;
-					rr.lhs = prevHelper;
-					rr.rhs.push_back(std::vector<Symbol>{ prod[i], prod[i + 1] });
-					extraRules.push_back(std::move(rr));
-					break;
-				}
-				else
-				{
-					std::string nextHelper = makeFreshNonterminal(g, "X");
-					g.nonterminals.insert(nextHelper);
-
-					Rule rr;
-					rr.lhs = prevHelper;
-					rr.rhs.push_back(std::vector<Symbol>{ prod[i], Symbol{ false, nextHelper }});
-					extraRules.push_back(std::move(rr));
-
-					prevHelper = nextHelper;
-				}
-			}
+			std::cout << "NOT equivalent, witness \"" << p.min.witness << "\" accepted by "
+					  << (p.min.g1Accepts ? names[p.a] : names[p.b]) << " only\n";
 		}
+		else
+		{
+			std::cout << "no counterexample found";
+			if (p.diff.stop != SearchStop::Trials)
+				std::cout << " before the " << searchStopName(p.diff.stop) << " ran out (" << p.diff.trials << " trials)";
+			std::cout << "\n";
+			parent[findClass(parent, p.a)] = findClass(parent, p.b);
+		}
+		printTuningLog(p.diff, "  ");
+	}
 
-		r.rhs = std::move(newRhs);
+	// classes numbered in order of their first member
+	std::vector<size_t> classOf(n, SIZE_MAX);
+	std::vector<std::vector<size_t>> classes;
+	for (size_t i = 0; i < n; ++i)
+	{
+		const size_t root = findClass(parent, i);
+		if (classOf[root] == SIZE_MAX)
+		{
+			classOf[root] = classes.size();
+			classes.emplace_back();
+		}
+		classes[classOf[root]].push_back(i);
 	}
 
-	for (auto& rr : extraRules)
+	std::cout << "Equivalence classes:\n";
+	for (size_t c = 0; c < classes.size(); ++c)
 	{
-		g.rules.push_back(std::move(rr));
+		std::cout << "  " << c + 1 << ":";
+		for (size_t i : classes[c])
+			std::cout << " " << names[i];
+		std::cout << "\n";
 	}
 
-	rebuildSymbolSets(g);
+	for (const auto& p : pairs)
+	{
+		if (p.diff.found && findClass(parent, p.a) == findClass(parent, p.b))
+		{
+			std::cout << "Warning: " << names[p.a] << " and " << names[p.b]
+					  << " differ but are linked through other pairs the search could not separate\n";
+		}
+	}
 }
 
-// function to convert a grammar to chomsky normal form
-Grammar CNF(Grammar& g) 
-{
-	std::string start = g.rules[0].lhs;
-	addFreshStartSymbol(g, start);
-
-	start = g.rules[0].lhs;
-	removeEpsilonProductions(g, start);
-	removeUnitProductions(g);
+// lines per batch in --check mode, which bounds its memory
+constexpr size_t CHECK_BATCH_LINES = 16384;
 
-	start = g.rules[0].lhs;
-	removeUselessSymbols(g, start);
-
-	eliminateTerminalsFromLong(g);
-	binarizeRules(g);
+int checkCorpusFile(const std::vector<CompiledGrammar>& grammars, const Options& opts)
+{
+	std::ifstream corpus(opts.checkFile);
+	if (!corpus)
+	{
+		std::cerr << "Error: Could not open file '" << opts.checkFile << "'" << std::endl;
+		return 1;
+	}
 
-	return g;
-}
+	std::vector<const Grammar*> gs;
+	std::vector<const CykIndex*> idxs;
+	for (const auto& cg : grammars)
+	{
+		gs.push_back(&cg.grammar);
+		idxs.push_back(&cg.index);
+	}
 
+	std::cout << "Checking " << opts.checkFile << "...\n";
+	CorpusStats stats = checkCorpus(corpus, gs, idxs, opts.tokenizer, opts.threads, CHECK_BATCH_LINES, std::cout);
 
-void printGrammar(const Grammar& g)
-{
-	for (const auto& rule : g.rules)
+	std::cout << "Lines checked: " << stats.lines << "\n";
+	std::cout << "Accepted by G1: " << stats.accepted[0] << "\n";
+	if (grammars.size() == 2)
 	{
-		std::cout << rule.lhs << " -> ";
-
-		for (size_t i = 0; i < rule.rhs.size(); ++i)
-		{
-			for (const auto& symbol : rule.rhs[i])
-			{
-				if (symbol.isTerminal && symbol.name != "epsilon")
-					std::cout << "\"" << symbol.name << "\" ";
-				else
-					std::cout << symbol.name << " ";
-			}
-			if (i != rule.rhs.size() - 1)
-				std::cout << "| ";
-			else
-				std::cout << ";\n";
-		}
+		std::cout << "Accepted by G2: " << stats.accepted[1] << "\n";
+		std::cout << "Differences: " << stats.differences << "\n";
 	}
+	std::cout << "Throughput: " << static_cast<uint64_t>(stats.lines / std::max(stats.seconds, 1e-9))
+			  << " lines/sec\n";
+	return 0;
 }
 
-
-void testGrammars(const Grammar& g1, const Grammar& g2)
+/*
+ * parse a grammar, convert it to CNF and index it, or load all of that from the
+ * cache when this exact source has been compiled before. false after reporting a
+ * syntax error
+ */
+bool compileGrammar(std::string_view input, const std::string& filename, int n, const Options& opts, CompiledGrammar& cg)
 {
-	std::cout << "Building CYK index for grammar 1...\n";
-	CykIndex idx1 = buildCykIndex(g1);
-	std::cout << "Index for grammar 1 built successfully!\n";
-	std::cout << "Building CYK index for grammar 2...\n";
-	CykIndex idx2 = buildCykIndex(g2);
-	std::cout << "Index for grammar 2 built successfully!\n";
+	const std::string cacheDir = opts.cache ? grammarCacheDir() : "";
 
-	GenSettings cfg;
-	cfg.maxSteps = 200;
-	cfg.maxLen = 40;
-	cfg.targetMin = 1;
-	cfg.targetMax = 20;
+	if (loadCompiledGrammar(cacheDir, input, cg))
+	{
+		std::cout << "Grammar " << n << " loaded from cache!\n";
+		return true;
+	}
 
-	std::cout << "Attempting to find equivalence counterexamples...\n";
-	auto res = findCounterExample(g1, g1.rules[0].lhs, idx1,
-								 g2, g2.rules[0].lhs, idx2,
-								 5000, 1874592, cfg);
+	Parser parser{input};
 
-	if (res.found)
+	std::cout << "Parsing grammar " << n << "...\n";
+	try
 	{
-		std::cout << "Grammars are NOT equivalent.\n";
-		std::cout << "Witness: " << res.witness << "\n";
-		std::cout << "G1 accepts: " << res.g1Accepts << "\n";
-		std::cout << "G2 accepts: " << res.g2Accepts << "\n";
+		cg.grammar = parser.parseGrammar();
 	}
-	else
+	catch (const SyntaxError& e)
 	{
-		std::cout << "No counterexample found in budget.\n";
+		std::cerr << "Error: " << filename << ":" << e.line << ":" << e.column << ": " << e.what() << std::endl;
+		return false;
 	}
+	std::cout << "Grammar " << n << " parsed successfully!\n";
+
+	// convert the grammar to Chomsky normal form.
+	std::cout << "Converting grammar " << n << " into Chomsky Normal Form...\n";
+	CNF(cg.grammar);
+	std::cout << "Grammar " << n << " converted successfully!\n";
+
+	std::cout << "Building CYK index for grammar " << n << "...\n";
+	cg.index = buildCykIndex(cg.grammar);
+	std::cout << "Index for grammar " << n << " built successfully!\n";
+
+	storeCompiledGrammar(cacheDir, input, cg);
+	return true;
 }
 
 
@@ -792,65 +629,60 @@ int main(int argc, char* argv[])
 	
 
 	// error if user puts the incorrect number of args
-	if (argc != 3)
+	Options opts;
+	if (!parseOptions(argc, argv, opts))
 	{
-		std::cerr << "Usage: " << argv[0] << " <input filename 1> <input filename 2>" << std::endl;
+		std::cerr << "Usage: " << argv[0] << " [--threads N] [--max-steps N] [--uniform | --adaptive] [--trials N] [--time-budget S] [--max-memory SIZE] [--seed N] [--no-cache] [--stats] [--exhaustive-upto K | --shortest-upto K] <input filename 1> <input filename 2>\n"
+				  << "       " << argv[0] << " --matrix [--threads N] [--max-steps N] [--uniform | --adaptive] [--trials N] [--time-budget S] [--max-memory SIZE] [--seed N] [--no-cache] [--stats] <input filename 1> ... <input filename N>\n"
+				  << "       " << argv[0] << " --check <corpus> [--tokenizer chars|words] [--threads N] [--no-cache] [--stats] <input filename 1> [<input filename 2>]" << std::endl;
 		return 1;	
 	}
 
 	std::cout << "Attempting to open grammar files...\n";
 
-	std::string filename1 = argv[1];
-	std::string filename2 = argv[2];
-
-	std::ifstream inFile1(filename1);
-	std::ifstream inFile2(filename2);
-	
-	
-	// error if program can't read one of the files.
-	if (!inFile1)
-	{
-		std::cerr << "Error: Could not open file '" << filename1 << "'" << std::endl;
-		return 1;
-	}
-	// put the entire file contents into a string and create the parser
-	std::string input1 { std::istreambuf_iterator<char>(inFile1), std::istreambuf_iterator<char>() };
-
-	std::cout << filename1 << " opened successfully!\n";
-
-	if (!inFile2)
+	std::vector<CompiledGrammar> grammars(opts.files.size());
+	for (size_t i = 0; i < opts.files.size(); ++i)
 	{
-		std::cerr << "Error: Could not open file '" << filename2 << "'" << std::endl;
-		return 1;
-	}
-
-	std::string input2 { std::istreambuf_iterator<char>(inFile2), std::istreambuf_iterator<char>() };
+		const std::string& filename = opts.files[i];
 
-	std::cout << filename2 << " opened successfully!\n";
+		// the file is mapped rather than read; the parser works on it in place
+		SourceFile inFile;
 
-	Parser parser1{input1};
-	Parser parser2{input2};
-
-	std::cout << "Parsing grammar 1...\n";
-
-	Grammar grammar1 = parser1.parseGrammar();
+		// error if program can't read one of the files.
+		if (!inFile.open(filename))
+		{
+			std::cerr << "Error: Could not open file '" << filename << "'" << std::endl;
+			return 1;
+		}
 
-	std::cout << "Grammar 1 parsed successfully!\n";
-	std::cout << "Parsing grammar 2...\n";
+		std::cout << filename << " opened successfully!\n";
 
-	Grammar grammar2 = parser2.parseGrammar();
+		if (!compileGrammar(inFile.text(), filename, static_cast<int>(i + 1), opts, grammars[i]))
+			return 1;
+	}
 
-	std::cout << "Grammar 2 parsed successfully!\n";
+	if (opts.stats)
+		enableStats();
 
-	// convert the grammars to Chomsky normal form.
-	std::cout << "Converting grammar 1 into Chomsky Normal Form...\n";
-	CNF(grammar1);
-	std::cout << "Grammar 1 converted successfully!\n";
-	std::cout << "Converting grammar 2 into Chomsky Normal Form...\n";
-	CNF(grammar2);
-	std::cout << "Grammar 2 converted successfully!\n";
+	int status = 0;
+	{
+		// counts the work done on this thread; worker threads have scopes of their own
+		StatsScope stats;
+
+		if (!opts.checkFile.empty())
+			status = checkCorpusFile(grammars, opts);
+		else if (opts.matrix)
+			compareMatrix(grammars, opts.files, opts);
+		else if (opts.exhaustiveUpto > 0)
+			compareUpTo(grammars[0].grammar, grammars[1].grammar, opts.exhaustiveUpto);
+		else if (opts.shortestUpto > 0)
+			findShortest(grammars[0], grammars[1], opts.shortestUpto);
+		else
+			testGrammars(grammars[0], grammars[1], opts);
+	}
 
-	testGrammars(grammar1, grammar2);
+	if (opts.stats)
+		writeStatsJson(collectedStats(), std::cout);
 
-	return 0;
+	return status;
 }
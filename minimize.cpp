@@ -0,0 +1,159 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "minimize.h"
+#include <algorithm>
+#include <unordered_map>
+
+MinimizeResult minimizeCounterExample(
+    const Grammar& g1,
+    SymbolId s1,
+    const BitCykIndex& bidx1,
+    const Grammar& g2,
+    SymbolId s2,
+    const BitCykIndex& bidx2,
+    const std::vector<std::string>& tokens,
+    CykWorkspace& ws)
+{
+    MinimizeResult res;
+
+    // candidates are strings over a joint alphabet of both grammars' terminals, sorted by
+    // name so that replacing a token by a smaller id also makes it read simpler
+    std::vector<std::string> alphabet;
+    for (SymbolId t = 1; t < g1.symbols.terminalCount(); ++t)
+        alphabet.push_back(g1.symbols.terminalName(t));
+    for (SymbolId t = 1; t < g2.symbols.terminalCount(); ++t)
+        alphabet.push_back(g2.symbols.terminalName(t));
+    for (const auto& t : tokens)
+        alphabet.push_back(t);
+    std::sort(alphabet.begin(), alphabet.end());
+    alphabet.erase(std::unique(alphabet.begin(), alphabet.end()), alphabet.end());
+
+    std::vector<SymbolId> to1(alphabet.size()), to2(alphabet.size());
+    for (size_t j = 0; j < alphabet.size(); ++j)
+    {
+        to1[j] = g1.symbols.findTerminal(alphabet[j]);
+        to2[j] = g2.symbols.findTerminal(alphabet[j]);
+    }
+
+    std::vector<SymbolId> w;
+    for (const auto& t : tokens)
+        w.push_back(static_cast<SymbolId>(std::lower_bound(alphabet.begin(), alphabet.end(), t) - alphabet.begin()));
+
+    std::vector<SymbolId> w1, w2;
+
+    // candidate -> (G1 accepts, G2 accepts)
+    std::unordered_map<std::vector<SymbolId>, std::pair<bool, bool>, WordHash> cache;
+
+    auto membership = [&](const std::vector<SymbolId>& cand) -> std::pair<bool, bool>
+    {
+        ++res.candidates;
+        auto it = cache.find(cand);
+        if (it != cache.end())
+            return it->second;
+
+        translateWord(to1, cand, w1);
+        translateWord(to2, cand, w2);
+        res.cykCalls += 2;
+        const std::pair<bool, bool> ans{ cykAcceptsBits(g1, bidx1, s1, w1, ws), cykAcceptsBits(g2, bidx2, s2, w2, ws) };
+        cache.emplace(cand, ans);
+        return ans;
+    };
+
+    auto differs = [&](const std::vector<SymbolId>& cand) -> bool
+    {
+        const auto [a, b] = membership(cand);
+        return a != b;
+    };
+
+    // the empty string is the best possible outcome, so it is worth one question up front
+    if (!w.empty() && differs({}))
+    {
+        w.clear();
+        ++res.steps;
+    }
+
+    size_t n = 2;
+    std::vector<SymbolId> cand;
+    while (w.size() >= 2)
+    {
+        const size_t chunk = (w.size() + n - 1) / n;
+        bool reduced = false;
+
+        // try each chunk on its own
+        for (size_t start = 0; start < w.size() && !reduced; start += chunk)
+        {
+            cand.assign(w.begin() + start, w.begin() + std::min(w.size(), start + chunk));
+            if (cand.size() < w.size() && differs(cand))
+            {
+                w = cand;
+                n = 2;
+                reduced = true;
+            }
+        }
+
+        // then each complement
+        for (size_t start = 0; start < w.size() && !reduced; start += chunk)
+        {
+            cand.assign(w.begin(), w.begin() + start);
+            cand.insert(cand.end(), w.begin() + std::min(w.size(), start + chunk), w.end());
+            if (differs(cand))
+            {
+                w = cand;
+                n = std::max<size_t>(n - 1, 2);
+                reduced = true;
+            }
+        }
+
+        if (reduced)
+        {
+            ++res.steps;
+            continue;
+        }
+
+        if (n >= w.size())
+            break;
+        n = std::min(n * 2, w.size());
+    }
+
+    // replace tokens by smaller ones, leftmost first
+    for (size_t i = 0; i < w.size(); ++i)
+    {
+        for (SymbolId j = 0; j < w[i]; ++j)
+        {
+            cand = w;
+            cand[i] = j;
+            if (differs(cand))
+            {
+                w = cand;
+                ++res.steps;
+                break;
+            }
+        }
+    }
+
+    const auto [a, b] = membership(w);
+    res.g1Accepts = a;
+    res.g2Accepts = b;
+    for (SymbolId j : w)
+    {
+        res.tokens.push_back(alphabet[j]);
+        res.witness += alphabet[j];
+    }
+
+    return res;
+}
@@ -0,0 +1,56 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MINIMIZE_H__
+#define __MINIMIZE_H__
+
+#include <string>
+#include <vector>
+#include "grammar.h"
+#include "cyk.h"
+
+struct MinimizeResult
+{
+    std::vector<std::string> tokens;
+    std::string witness;
+    bool g1Accepts = false;
+    bool g2Accepts = false;
+
+    size_t steps = 0; // accepted reductions
+    size_t candidates = 0; // membership questions asked
+    size_t cykCalls = 0; // questions that actually reached CYK
+};
+
+/*
+ * shrink a witness with ddmin (Zeller and Hildebrandt): try chunks and their complements
+ * at finer and finer granularity, keeping any candidate that the two grammars still
+ * disagree on. afterwards each token is replaced by the smallest terminal that keeps the
+ * disagreement. answers are cached, so every distinct candidate is parsed at most once.
+ * the bitset indexes are the ones the search already built, and all CYK runs share the
+ * caller's workspace.
+ */
+MinimizeResult minimizeCounterExample(
+    const Grammar& g1,
+    SymbolId s1,
+    const BitCykIndex& bidx1,
+    const Grammar& g2,
+    SymbolId s2,
+    const BitCykIndex& bidx2,
+    const std::vector<std::string>& tokens,
+    CykWorkspace& ws);
+
+#endif
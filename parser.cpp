@@ -16,8 +16,8 @@
  */
 
 #include "parser.h"
-#include <iostream>
-#include <cstdlib>
+#include <string>
+#include <utility>
 
 /*
  * Meta Grammar for parsing CFGs:
@@ -33,7 +33,7 @@
  */
 
 
-Parser::Parser(const std::string& input)
+Parser::Parser(std::string_view input)
 : lexer(Lexer(input))
 {
 }
@@ -42,14 +42,16 @@ Token Parser::expect(TokenType type)
 {
 	Token t = lexer.getToken();
 	if (t.tokenType != type)
-		syntaxError();
+		syntaxError(t, tokenTypeName(type));
 	return t;
 }
 
-void Parser::syntaxError()
+void Parser::syntaxError(const Token& found, const std::string& expected)
 {
-	std::cerr << "Syntax Error" << std::endl;
-	exit(1);
+	std::string msg = "expected " + expected + " but found " + tokenTypeName(found.tokenType);
+	if (found.tokenType == TokenType::ID || found.tokenType == TokenType::STRING)
+		msg += " '" + std::string(found.lexeme) + "'";
+	lexer.error(found.offset, msg);
 }
 
 Grammar Parser::parseGrammar()
@@ -57,20 +59,22 @@ Grammar Parser::parseGrammar()
 	// grammar -> ruleList END_OF_FILE
 	parseRuleList();
 	expect(TokenType::END_OF_FILE);
-	return grammar;
+
+	// the first rule's lhs is the start symbol
+	grammar.start = grammar.rules.front().lhs;
+	grammar.buildIndex();
+	return std::move(grammar);
 }
 
 void Parser::parseRuleList()
 {
 	// ruleList -> rule | rule ruleList
-	Rule r = parseRule();
-	grammar.rules.push_back(r);
-
-	Token t = lexer.peek();
-	if (t.tokenType == TokenType::ID)
+	// the right recursion is a loop, so long grammars cannot exhaust the stack
+	do
 	{
-		parseRuleList();
+		grammar.rules.push_back(parseRule());
 	}
+	while (lexer.peek().tokenType == TokenType::ID);
 }
 
 Rule Parser::parseRule()
@@ -78,10 +82,11 @@ Rule Parser::parseRule()
 	// rule -> ID ARROW rhs SEMICOLON
 	Rule r;
 
-	Token lhsToken = expect(TokenType::ID);
-	r.lhs = lhsToken.lexeme;
-	if (grammar.nonterminals.find(lhsToken.lexeme) == grammar.nonterminals.end())
-		grammar.nonterminals.insert(lhsToken.lexeme);
+	Token lhsToken = lexer.getToken();
+	if (lhsToken.tokenType != TokenType::ID)
+		syntaxError(lhsToken, "a rule");
+	r.lhs = grammar.symbols.internNonterminal(lhsToken.lexeme);
+	grammar.nonterminals.insert(r.lhs);
 
 	expect(TokenType::ARROW);
 	r.rhs = parseRhs();
@@ -93,16 +98,12 @@ std::vector<std::vector<Symbol>> Parser::parseRhs()
 {
 	// rhs -> alternative | alternative OR rhs
 	std::vector<std::vector<Symbol>> rhs_mat;
-	std::vector<Symbol> alt = parseAlternative();
-	rhs_mat.push_back(alt);	
-
+	rhs_mat.push_back(parseAlternative());
 
-	Token t = lexer.peek();
-	if (t.tokenType == TokenType::OR)
+	while (lexer.peek().tokenType == TokenType::OR)
 	{
 		expect(TokenType::OR);
-		std::vector<std::vector<Symbol>> temp = parseRhs();
-		rhs_mat.insert(rhs_mat.end(), temp.begin(), temp.end());
+		rhs_mat.push_back(parseAlternative());
 	}
 
 	return rhs_mat;
@@ -116,19 +117,22 @@ std::vector<Symbol> Parser::parseAlternative()
 	Token t = lexer.peek();
 	if (t.tokenType == TokenType::EPSILON)
 	{
-		t = expect(TokenType::EPSILON);
+		expect(TokenType::EPSILON);
 		Symbol s;
 		s.isTerminal = true;
-		s.name = t.lexeme;
-		if (grammar.terminals.find(t.lexeme) == grammar.terminals.end())
-			grammar.terminals.insert(t.lexeme);
+		s.id = EPSILON_ID;
+		grammar.terminals.insert(s.id);
 
 		alt.push_back(s);
 	}
-	else
+	else if (t.tokenType == TokenType::ID || t.tokenType == TokenType::STRING)
 	{
 		alt = parseSymbolList();
 	}
+	else
+	{
+		syntaxError(t, "a symbol or 'epsilon'");
+	}
 	
 	return alt;
 }
@@ -137,15 +141,12 @@ std::vector<Symbol> Parser::parseSymbolList()
 {
 	// symbolList -> symbol | symbol symbolList
 	std::vector<Symbol> symbolList;
-	Symbol s = parseSymbol();
-	symbolList.push_back(s);	
 
-	Token t = lexer.peek();
-	if (t.tokenType == TokenType::ID || t.tokenType == TokenType::STRING)
+	do
 	{
-		std::vector<Symbol> temp = parseSymbolList();
-		symbolList.insert(symbolList.end(), temp.begin(), temp.end());
+		symbolList.push_back(parseSymbol());
 	}
+	while (lexer.peek().tokenType == TokenType::ID || lexer.peek().tokenType == TokenType::STRING);
 
 	return symbolList;
 }
@@ -154,28 +155,23 @@ Symbol Parser::parseSymbol()
 {
 	// symbol -> ID | STRING
 	Symbol s;
-	Token t = lexer.peek();
+	Token t = lexer.getToken();
 	if (t.tokenType == TokenType::ID)
 	{
-		t = expect(TokenType::ID);
 		s.isTerminal = false;
-		s.name = t.lexeme;
-		if (grammar.nonterminals.find(t.lexeme) == grammar.nonterminals.end())
-			grammar.nonterminals.insert(t.lexeme);
+		s.id = grammar.symbols.internNonterminal(t.lexeme);
+		grammar.nonterminals.insert(s.id);
 	}
-	else
+	else if (t.tokenType == TokenType::STRING)
 	{
-		t = expect(TokenType::STRING);
 		s.isTerminal = true;
-		s.name = t.lexeme;
-		if (grammar.terminals.find(t.lexeme) == grammar.terminals.end())
-			grammar.terminals.insert(t.lexeme);
+		s.id = grammar.symbols.internTerminal(t.lexeme);
+		grammar.terminals.insert(s.id);
+	}
+	else
+	{
+		syntaxError(t, "a symbol");
 	}
 
 	return s;
 }
-
-
-
-
-
@@ -24,10 +24,12 @@
 class Parser 
 {
 public:
-	Parser(const std::string& input);
+	// syntax errors are thrown as SyntaxError, see lexer.h
+	Parser(std::string_view input);
 	
 	Token expect(TokenType type);
-	void syntaxError();
+	// throws a SyntaxError at the token naming what was expected instead
+	[[noreturn]] void syntaxError(const Token& found, const std::string& expected);
 	Grammar parseGrammar();
 	void parseRuleList();
 	Rule parseRule();
@@ -19,19 +19,42 @@
 #define __RULE_H__
 
 #include <vector>
-#include <string>
+#include <cstddef>
+#include "symbols.h"
 
 class Symbol
 {
 public:
 	bool isTerminal;
-	std::string name;
+	SymbolId id;
+};
+
+inline bool operator==(const Symbol& a, const Symbol& b)
+{
+	return a.isTerminal == b.isTerminal && a.id == b.id;
+}
+
+/*
+ * ProdHash lets whole productions be used as keys when deduplicating alternatives
+ */
+struct ProdHash
+{
+	size_t operator()(const std::vector<Symbol>& prod) const noexcept
+	{
+		size_t h = prod.size();
+		for (const auto& s : prod)
+		{
+			size_t v = (static_cast<size_t>(s.id) << 1) | (s.isTerminal ? 1u : 0u);
+			h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+		}
+		return h;
+	}
 };
 
 class Rule
 {
 public:
-	std::string lhs;
+	SymbolId lhs;
 	std::vector<std::vector<Symbol>> rhs;
 };
 
@@ -0,0 +1,203 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "shortest.h"
+#include "uniform.h"
+#include <cmath>
+#include <unordered_set>
+
+namespace
+{
+    /*
+     * walks every derivation tree of (start, n) in one grammar, using the derivation
+     * counts to skip splits with no trees, and checks each finished string against the
+     * other grammar's chart. terminals reach the chart in order as they are produced.
+     */
+    struct SliceWalker
+    {
+        const UniformSampler& us;
+        PrefixChart& other;
+        SymbolId otherStart;
+        const std::vector<SymbolId>& toOther;
+        size_t limit;
+
+        std::vector<SymbolId> word;
+        std::vector<std::pair<SymbolId, size_t>> pending;
+        std::unordered_set<std::vector<SymbolId>, WordHash> seen;
+        size_t visits = 0;
+        bool limitHit = false;
+        bool found = false;
+
+        SliceWalker(const UniformSampler& us, PrefixChart& other, SymbolId otherStart,
+                    const std::vector<SymbolId>& toOther, size_t limit)
+        : us(us),
+          other(other),
+          otherStart(otherStart),
+          toOther(toOther),
+          limit(limit)
+        {
+        }
+
+        bool done() const
+        {
+            return found || limitHit;
+        }
+
+        void walk()
+        {
+            if (pending.empty())
+            {
+                if (++visits > limit)
+                {
+                    limitHit = true;
+                    return;
+                }
+
+                if (seen.insert(word).second && !other.accepts(otherStart))
+                    found = true;
+                return;
+            }
+
+            const auto [A, len] = pending.back();
+            pending.pop_back();
+
+            if (len == 1)
+            {
+                for (SymbolId t : us.termProds[A])
+                {
+                    word.push_back(t);
+                    other.push(toOther[t]);
+                    walk();
+
+                    if (done())
+                        return;
+                    other.pop();
+                    word.pop_back();
+                }
+            }
+            else
+            {
+                for (const auto& [B, C] : us.binProds[A])
+                {
+                    const size_t last = us.lastSplit(C, len);
+                    for (size_t k = us.firstSplit(B); k <= last; ++k)
+                    {
+                        if (std::isinf(us.logCountOf(B, k)) || std::isinf(us.logCountOf(C, len - k)))
+                            continue;
+
+                        pending.push_back({ C, len - k });
+                        pending.push_back({ B, k });
+                        walk();
+
+                        if (done())
+                            return;
+                        pending.pop_back();
+                        pending.pop_back();
+                    }
+                }
+            }
+
+            pending.push_back({ A, len });
+        }
+    };
+}
+
+ShortestResult findShortestCounterExample(
+    const Grammar& g1,
+    SymbolId s1,
+    const CykIndex& idx1,
+    const Grammar& g2,
+    SymbolId s2,
+    const CykIndex& idx2,
+    size_t maxLen,
+    const ShortestLimits& limits)
+{
+    ShortestResult res;
+
+    const UniformSampler us1 = buildUniformSampler(g1, s1, maxLen);
+    const UniformSampler us2 = buildUniformSampler(g2, s2, maxLen);
+    const BitCykIndex bidx1 = buildBitCykIndex(g1, idx1);
+    const BitCykIndex bidx2 = buildBitCykIndex(g2, idx2);
+    const std::vector<SymbolId> map12 = buildTerminalMap(g1.symbols, g2.symbols);
+    const std::vector<SymbolId> map21 = buildTerminalMap(g2.symbols, g1.symbols);
+
+    PrefixChart chart1, chart2;
+
+    if (us1.startNullable != us2.startNullable)
+    {
+        res.found = true;
+        res.g1Accepts = us1.startNullable;
+        res.g2Accepts = us2.startNullable;
+        return res;
+    }
+
+    for (size_t n = 1; n <= maxLen; ++n)
+    {
+        const double c1 = us1.logCountOf(s1, n);
+        const double c2 = us2.logCountOf(s2, n);
+
+        // start with the side that has fewer derivations of this length
+        const bool oneFirst = c1 <= c2;
+        bool equal = false;
+
+        for (int pass = 0; pass < 2 && !equal; ++pass)
+        {
+            const bool genIsG1 = (pass == 0) == oneFirst;
+            const UniformSampler& usG = genIsG1 ? us1 : us2;
+            const Grammar& genG = genIsG1 ? g1 : g2;
+            PrefixChart& chartO = genIsG1 ? chart2 : chart1;
+            chartO.reset(genIsG1 ? bidx2 : bidx1, n);
+
+            SliceWalker walker(usG, chartO, genIsG1 ? s2 : s1, genIsG1 ? map12 : map21, limits.maxStrings);
+            if (!std::isinf(usG.logCountOf(genIsG1 ? s1 : s2, n)))
+            {
+                walker.pending.push_back({ genIsG1 ? s1 : s2, n });
+                walker.walk();
+            }
+            res.stringsChecked += walker.seen.size();
+
+            if (walker.found)
+            {
+                res.found = true;
+                res.witness = joinTokens(genG.symbols, walker.word);
+                res.g1Accepts = genIsG1;
+                res.g2Accepts = !genIsG1;
+                return res;
+            }
+            if (walker.limitHit)
+            {
+                res.gaveUp = true;
+                res.gaveUpAt = n;
+                res.reason = "string limit reached";
+                return res;
+            }
+
+            // every string of this slice is in the other slice. if the other grammar has no
+            // more derivations than there are strings here, its slice cannot be any bigger
+            if (pass == 0)
+            {
+                const double cO = genIsG1 ? c2 : c1;
+                const double distinct = static_cast<double>(walker.seen.size());
+                equal = std::isinf(cO) ? distinct == 0 : std::round(std::exp(cO)) <= distinct;
+            }
+        }
+
+        res.completedLength = n;
+    }
+
+    return res;
+}
@@ -0,0 +1,64 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHORTEST_H__
+#define __SHORTEST_H__
+
+#include <string>
+#include <vector>
+#include "grammar.h"
+#include "cyk.h"
+
+struct ShortestLimits
+{
+    size_t maxStrings = 2000000; // derivation trees walked per length and direction
+};
+
+struct ShortestResult
+{
+    bool found = false;
+    std::string witness;
+    bool g1Accepts = false;
+    bool g2Accepts = false;
+
+    size_t completedLength = 0; // no counterexample has length <= this
+    bool gaveUp = false;
+    size_t gaveUpAt = 0;
+    std::string reason;
+
+    size_t stringsChecked = 0; // distinct strings tested against the other grammar
+};
+
+/*
+ * iterative deepening over length for two CNF grammars. for each length the grammar
+ * with fewer derivations of that length has its slice enumerated depth first, and
+ * every string is tested against the other grammar on a PrefixChart, so strings with
+ * a common prefix share that part of the chart. the other slice is only enumerated
+ * when the derivation counts cannot show that the two slices have the same size.
+ * the first witness found is therefore a shortest one.
+ */
+ShortestResult findShortestCounterExample(
+    const Grammar& g1,
+    SymbolId s1,
+    const CykIndex& idx1,
+    const Grammar& g2,
+    SymbolId s2,
+    const CykIndex& idx2,
+    size_t maxLen,
+    const ShortestLimits& limits);
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "source.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+SourceFile::~SourceFile()
+{
+	if (data != nullptr)
+		::munmap(data, size);
+}
+
+bool SourceFile::open(const std::string& path)
+{
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		::close(fd);
+		return false;
+	}
+
+	// an empty file cannot be mapped, and its text is simply empty
+	size = static_cast<size_t>(st.st_size);
+	if (size > 0)
+	{
+		void* map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			::close(fd);
+			size = 0;
+			return false;
+		}
+		data = map;
+	}
+
+	::close(fd);
+	return true;
+}
+
+std::string_view SourceFile::text() const
+{
+	return std::string_view(static_cast<const char*>(data), size);
+}
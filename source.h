@@ -0,0 +1,49 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __SOURCE_H__
+#define __SOURCE_H__
+
+#include <string>
+#include <string_view>
+
+/*
+ * SourceFile maps a grammar file read-only into memory. the lexer and the cache
+ * read its text in place, so no copy of the file is ever made. the mapping lives
+ * as long as the object.
+ */
+class SourceFile
+{
+public:
+	SourceFile() = default;
+	~SourceFile();
+
+	SourceFile(const SourceFile&) = delete;
+	SourceFile& operator=(const SourceFile&) = delete;
+
+	// false if the file cannot be opened or mapped
+	bool open(const std::string& path);
+
+	std::string_view text() const;
+
+private:
+	void* data = nullptr;
+	size_t size = 0;
+};
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "stats.h"
+#include <bit>
+#include <mutex>
+
+thread_local constinit SearchStats* currentStats = nullptr;
+
+static bool enabled = false;
+static std::mutex totalsMutex;
+static SearchStats totals;
+
+void SearchStats::merge(const SearchStats& other)
+{
+    trials += other.trials;
+    derivations += other.derivations;
+    abandonedStepLimit += other.abandonedStepLimit;
+    abandonedMaxLen += other.abandonedMaxLen;
+    abandonedMissingRule += other.abandonedMissingRule;
+    duplicates += other.duplicates;
+    alternativeChoices += other.alternativeChoices;
+    for (size_t r = 0; r < STATS_REGIMES; ++r)
+        regimeChoices[r] += other.regimeChoices[r];
+    cykCalls += other.cykCalls;
+    pairProbes += other.pairProbes;
+    pairHits += other.pairHits;
+    for (size_t b = 0; b < STATS_CELL_BUCKETS; ++b)
+        cellSizes[b] += other.cellSizes[b];
+
+    if (lengths.size() < other.lengths.size())
+        lengths.resize(other.lengths.size(), 0);
+    for (size_t n = 0; n < other.lengths.size(); ++n)
+        lengths[n] += other.lengths[n];
+}
+
+void SearchStats::addCellSize(size_t nonterminals)
+{
+    // bucket 0 is the empty cell, bucket b > 0 holds sizes in [2^(b-1), 2^b)
+    const size_t b = std::min<size_t>(std::bit_width(nonterminals), STATS_CELL_BUCKETS - 1);
+    ++cellSizes[b];
+}
+
+void SearchStats::addLength(size_t len)
+{
+    if (len >= lengths.size())
+        lengths.resize(len + 1, 0);
+    ++lengths[len];
+}
+
+void enableStats()
+{
+    enabled = true;
+}
+
+StatsScope::StatsScope()
+{
+    if (!enabled)
+        return;
+    active = true;
+    previous = currentStats;
+    currentStats = &local;
+}
+
+StatsScope::~StatsScope()
+{
+    if (!active)
+        return;
+    currentStats = previous;
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    totals.merge(local);
+}
+
+SearchStats collectedStats()
+{
+    std::lock_guard<std::mutex> lock(totalsMutex);
+    return totals;
+}
+
+void writeStatsJson(const SearchStats& s, std::ostream& os)
+{
+    auto array = [&](const uint64_t* values, size_t count)
+    {
+        os << "[";
+        for (size_t i = 0; i < count; ++i)
+            os << (i ? ", " : "") << values[i];
+        os << "]";
+    };
+
+    os << "{\n"
+       << "  \"trials\": " << s.trials << ",\n"
+       << "  \"duplicates\": " << s.duplicates << ",\n"
+       << "  \"derivations\": " << s.derivations << ",\n"
+       << "  \"abandoned\": {\"step_limit\": " << s.abandonedStepLimit
+       << ", \"max_len\": " << s.abandonedMaxLen
+       << ", \"missing_rule\": " << s.abandonedMissingRule << "},\n"
+       << "  \"alternative_choices\": " << s.alternativeChoices << ",\n"
+       << "  \"choices_by_regime\": ";
+    array(s.regimeChoices, STATS_REGIMES);
+    os << ",\n"
+       << "  \"cyk_calls\": " << s.cykCalls << ",\n"
+       << "  \"pair_probes\": " << s.pairProbes << ",\n"
+       << "  \"pair_hits\": " << s.pairHits << ",\n"
+       << "  \"cell_size_buckets\": ";
+    array(s.cellSizes, STATS_CELL_BUCKETS);
+    os << ",\n"
+       << "  \"length_histogram\": ";
+    array(s.lengths.data(), s.lengths.size());
+    os << "\n}\n";
+}
@@ -0,0 +1,103 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+/*
+ * counters for the hot paths: the search loop, generateString, the alternative
+ * choosers and both CYK parsers. they are compiled in only when CFG_STATS is defined
+ * (make STATS=1, the default); otherwise every STAT_ macro expands to nothing.
+ * even when compiled in, nothing is counted unless enableStats was called.
+ *
+ * each thread counts into its own SearchStats, installed by a StatsScope, so the
+ * hot paths never share counters between threads. a scope adds its counts to the
+ * process totals when it ends.
+ */
+
+constexpr size_t STATS_CELL_BUCKETS = 18; // chart cell sizes 0, 1, 2-3, 4-7, ..., 2^16 and up
+constexpr size_t STATS_REGIMES = 8; // one per generation regime, see GEN_REGIMES
+
+struct SearchStats
+{
+    uint64_t trials = 0; // search trials started
+    uint64_t derivations = 0; // generateString calls
+    uint64_t abandonedStepLimit = 0;
+    uint64_t abandonedMaxLen = 0;
+    uint64_t abandonedMissingRule = 0;
+    uint64_t duplicates = 0; // trials skipped because their string was tested before
+    uint64_t alternativeChoices = 0; // expansions of a nonterminal with two or more alternatives
+    uint64_t regimeChoices[STATS_REGIMES] = {}; // the same choices by regime
+    uint64_t cykCalls = 0;
+    uint64_t pairProbes = 0; // cykAcceptsBits searches of a B's (B, C) pair row
+    uint64_t pairHits = 0; // (B, C) pairs found there, each ORing its lhs set into a cell
+    uint64_t cellSizes[STATS_CELL_BUCKETS] = {}; // chart cells by number of nonterminals
+    std::vector<uint64_t> lengths; // generated strings by length
+
+    void merge(const SearchStats& other);
+    void addCellSize(size_t nonterminals);
+    void addLength(size_t len);
+};
+
+// the counters of the calling thread, null when it is not collecting. constinit lets
+// other files read it directly instead of through a TLS init wrapper
+extern thread_local constinit SearchStats* currentStats;
+
+void enableStats();
+
+/*
+ * collects the counts of the calling thread for its lifetime (if stats are enabled).
+ * scopes nest: an inner scope counts on its own and its totals are not added to the
+ * outer one, so nothing is counted twice.
+ */
+class StatsScope
+{
+public:
+    StatsScope();
+    ~StatsScope();
+
+    StatsScope(const StatsScope&) = delete;
+    StatsScope& operator=(const StatsScope&) = delete;
+
+private:
+    SearchStats local;
+    SearchStats* previous = nullptr;
+    bool active = false;
+};
+
+// the totals of every scope that has ended so far
+SearchStats collectedStats();
+
+void writeStatsJson(const SearchStats& s, std::ostream& os);
+
+#ifdef CFG_STATS
+constexpr bool STATS_COMPILED = true;
+#define STAT_ADD(field, n) do { if (SearchStats* stats_ = currentStats) stats_->field += (n); } while (0)
+#define STAT_CELL(size) do { if (SearchStats* stats_ = currentStats) stats_->addCellSize(size); } while (0)
+#define STAT_LENGTH(len) do { if (SearchStats* stats_ = currentStats) stats_->addLength(len); } while (0)
+#else
+constexpr bool STATS_COMPILED = false;
+#define STAT_ADD(field, n) do {} while (0)
+#define STAT_CELL(size) do {} while (0)
+#define STAT_LENGTH(len) do {} while (0)
+#endif
+
+#endif
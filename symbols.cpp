@@ -0,0 +1,110 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "symbols.h"
+
+SymbolTable::SymbolTable()
+: terminalNames{ "epsilon" }
+{
+}
+
+SymbolTable::SymbolTable(const SymbolTable& other)
+: terminalNames(other.terminalNames), nonterminalNames(other.nonterminalNames)
+{
+	reindex();
+}
+
+SymbolTable& SymbolTable::operator=(const SymbolTable& other)
+{
+	if (this != &other)
+	{
+		terminalNames = other.terminalNames;
+		nonterminalNames = other.nonterminalNames;
+		reindex();
+	}
+	return *this;
+}
+
+void SymbolTable::reindex()
+{
+	terminalIds.clear();
+	nonterminalIds.clear();
+
+	// epsilon (id 0) is never looked up by name
+	for (size_t id = 1; id < terminalNames.size(); ++id)
+		terminalIds.emplace(terminalNames[id], static_cast<SymbolId>(id));
+	for (size_t id = 0; id < nonterminalNames.size(); ++id)
+		nonterminalIds.emplace(nonterminalNames[id], static_cast<SymbolId>(id));
+}
+
+SymbolId SymbolTable::internTerminal(std::string_view name)
+{
+	auto it = terminalIds.find(name);
+	if (it != terminalIds.end())
+		return it->second;
+
+	SymbolId id = static_cast<SymbolId>(terminalNames.size());
+	// the only copy of the name is made here, the first time it is seen;
+	// the map keeps a view of it
+	terminalNames.emplace_back(name);
+	terminalIds.emplace(terminalNames.back(), id);
+	return id;
+}
+
+SymbolId SymbolTable::internNonterminal(std::string_view name)
+{
+	auto it = nonterminalIds.find(name);
+	if (it != nonterminalIds.end())
+		return it->second;
+
+	SymbolId id = static_cast<SymbolId>(nonterminalNames.size());
+	nonterminalNames.emplace_back(name);
+	nonterminalIds.emplace(nonterminalNames.back(), id);
+	return id;
+}
+
+SymbolId SymbolTable::findTerminal(std::string_view name) const
+{
+	auto it = terminalIds.find(name);
+	return it == terminalIds.end() ? NO_SYMBOL : it->second;
+}
+
+SymbolId SymbolTable::findNonterminal(std::string_view name) const
+{
+	auto it = nonterminalIds.find(name);
+	return it == nonterminalIds.end() ? NO_SYMBOL : it->second;
+}
+
+const std::string& SymbolTable::terminalName(SymbolId id) const
+{
+	return terminalNames[id];
+}
+
+const std::string& SymbolTable::nonterminalName(SymbolId id) const
+{
+	return nonterminalNames[id];
+}
+
+size_t SymbolTable::terminalCount() const
+{
+	return terminalNames.size();
+}
+
+size_t SymbolTable::nonterminalCount() const
+{
+	return nonterminalNames.size();
+}
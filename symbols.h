@@ -0,0 +1,76 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SYMBOLS_H__
+#define __SYMBOLS_H__
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <deque>
+#include <unordered_map>
+
+using SymbolId = uint32_t;
+
+// returned by lookups when a name has not been interned
+constexpr SymbolId NO_SYMBOL = UINT32_MAX;
+
+// terminal id 0 is reserved for epsilon. it is never looked up by name,
+// so a quoted "epsilon" literal is an ordinary terminal
+constexpr SymbolId EPSILON_ID = 0;
+
+/*
+ * SymbolTable interns terminal and nonterminal names into dense ids.
+ * terminals and nonterminals live in separate id spaces, so "a" and a
+ * can both exist. names are only needed again when printing.
+ * each name is stored once: the lookup maps are keyed by views into the
+ * name lists, which are deques so appending never moves a stored name,
+ * and the parser can probe them with views into the source without copying.
+ */
+class SymbolTable
+{
+public:
+	SymbolTable();
+
+	// a copy gets its own names, so its maps are rebuilt to point at them
+	SymbolTable(const SymbolTable& other);
+	SymbolTable& operator=(const SymbolTable& other);
+	SymbolTable(SymbolTable&&) = default;
+	SymbolTable& operator=(SymbolTable&&) = default;
+
+	SymbolId internTerminal(std::string_view name);
+	SymbolId internNonterminal(std::string_view name);
+
+	SymbolId findTerminal(std::string_view name) const;
+	SymbolId findNonterminal(std::string_view name) const;
+
+	const std::string& terminalName(SymbolId id) const;
+	const std::string& nonterminalName(SymbolId id) const;
+
+	size_t terminalCount() const;
+	size_t nonterminalCount() const;
+
+private:
+	void reindex();
+
+	std::deque<std::string> terminalNames;
+	std::deque<std::string> nonterminalNames;
+	std::unordered_map<std::string_view, SymbolId> terminalIds;
+	std::unordered_map<std::string_view, SymbolId> nonterminalIds;
+};
+
+#endif
@@ -0,0 +1,400 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * cfg_synth writes random grammars in the input format of cfg_comparator, for
+ * scale and stress testing. the same seed and parameters always give the same
+ * grammar. with --pair it writes a grammar and a mutated near-equivalent copy of it.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+
+struct SynthOptions
+{
+	uint64_t seed = 1;
+	size_t nonterminals = 10;
+	size_t alternatives = 3; // at most, per rule
+	size_t length = 4; // at most, per production
+	double nullable = 0.1; // chance that a nonterminal gets an epsilon alternative
+	size_t unitDepth = 0; // length of the unit production chains, 0 for none
+	size_t alphabet = 4;
+	size_t mutations = 1; // language changing edits in the second grammar of a pair
+	std::string pairPrefix; // write PREFIX_1.txt and PREFIX_2.txt instead of stdout
+};
+
+struct SynthSymbol
+{
+	bool terminal;
+	size_t id;
+};
+
+// an empty production is epsilon
+using Production = std::vector<SynthSymbol>;
+
+struct SynthRule
+{
+	size_t lhs;
+	std::vector<Production> alts;
+};
+
+struct SynthGrammar
+{
+	std::vector<std::string> nonterminalNames;
+	std::vector<std::string> terminalNames;
+	std::vector<SynthRule> rules; // rules.front() is the start rule
+};
+
+using Rng = std::mt19937_64;
+
+static size_t uniformIn(Rng& rng, size_t lo, size_t hi)
+{
+	return std::uniform_int_distribution<size_t>(lo, hi)(rng);
+}
+
+static bool chance(Rng& rng, double p)
+{
+	return std::uniform_real_distribution<double>(0.0, 1.0)(rng) < p;
+}
+
+static std::string terminalName(size_t i)
+{
+	if (i < 26)
+		return std::string(1, static_cast<char>('a' + i));
+	return "t" + std::to_string(i);
+}
+
+static size_t addNonterminal(SynthGrammar& g, const std::string& name)
+{
+	g.nonterminalNames.push_back(name);
+	g.rules.push_back(SynthRule{ g.nonterminalNames.size() - 1, {} });
+	return g.nonterminalNames.size() - 1;
+}
+
+/*
+ * nonterminal i always has a terminal-only alternative, so every nonterminal is
+ * generating and strings stay short however large the grammar is. its second
+ * alternative mentions its children 2i+1 and 2i+2, so every nonterminal is reachable
+ * from N0 within a logarithmic depth. the remaining alternatives mix terminals and
+ * arbitrary nonterminals, which is where the recursion comes from.
+ */
+static SynthGrammar generateGrammar(const SynthOptions& opts, Rng& rng)
+{
+	SynthGrammar g;
+	for (size_t t = 0; t < opts.alphabet; ++t)
+		g.terminalNames.push_back(terminalName(t));
+	for (size_t i = 0; i < opts.nonterminals; ++i)
+		addNonterminal(g, "N" + std::to_string(i));
+
+	const size_t n = opts.nonterminals;
+	auto randomTerminal = [&]() { return SynthSymbol{ true, uniformIn(rng, 0, opts.alphabet - 1) }; };
+	auto randomSymbol = [&]()
+	{
+		if (chance(rng, 0.5))
+			return randomTerminal();
+		return SynthSymbol{ false, uniformIn(rng, 0, n - 1) };
+	};
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		SynthRule& r = g.rules[i];
+		const size_t count = uniformIn(rng, 1, opts.alternatives);
+
+		Production base;
+		for (size_t k = uniformIn(rng, 1, opts.length); k > 0; --k)
+			base.push_back(randomTerminal());
+
+		std::vector<size_t> children;
+		for (size_t c = 2 * i + 1; c <= 2 * i + 2 && c < n; ++c)
+			children.push_back(c);
+
+		// with a single alternative the children have to hang off the base one
+		Production branch;
+		Production& withChildren = count > 1 ? branch : base;
+		for (size_t c : children)
+		{
+			const size_t at = uniformIn(rng, 0, withChildren.size());
+			withChildren.insert(withChildren.begin() + at, SynthSymbol{ false, c });
+		}
+		while (count > 1 && withChildren.size() < opts.length && chance(rng, 0.5))
+			withChildren.push_back(randomSymbol());
+
+		r.alts.push_back(std::move(base));
+		if (count > 1)
+		{
+			if (branch.empty())
+				branch.push_back(randomSymbol());
+			r.alts.push_back(std::move(branch));
+		}
+		while (r.alts.size() < count)
+		{
+			Production p;
+			for (size_t k = uniformIn(rng, 1, opts.length); k > 0; --k)
+				p.push_back(randomSymbol());
+			r.alts.push_back(std::move(p));
+		}
+		if (chance(rng, opts.nullable))
+			r.alts.push_back(Production{});
+	}
+
+	// a quarter of the nonterminals start a chain N -> U1 -> U2 ... -> Ud -> M of unit productions
+	if (opts.unitDepth > 0)
+	{
+		for (size_t c = 0; c < (n + 3) / 4; ++c)
+		{
+			size_t from = uniformIn(rng, 0, n - 1);
+			for (size_t d = 1; d <= opts.unitDepth; ++d)
+			{
+				const size_t u = addNonterminal(g, "U" + std::to_string(c) + "_" + std::to_string(d));
+				g.rules[from].alts.push_back(Production{ SynthSymbol{ false, u } });
+				from = u;
+			}
+			g.rules[from].alts.push_back(Production{ SynthSymbol{ false, uniformIn(rng, 0, n - 1) } });
+		}
+	}
+
+	return g;
+}
+
+// one small edit to a random production that usually changes the language
+static void mutateOnce(SynthGrammar& g, Rng& rng)
+{
+	std::vector<std::pair<size_t, size_t>> candidates;
+	for (size_t r = 0; r < g.rules.size(); ++r)
+	{
+		for (size_t a = 0; a < g.rules[r].alts.size(); ++a)
+		{
+			if (!g.rules[r].alts[a].empty())
+				candidates.emplace_back(r, a);
+		}
+	}
+	if (candidates.empty())
+		return;
+
+	const auto [r, a] = candidates[uniformIn(rng, 0, candidates.size() - 1)];
+	Production& p = g.rules[r].alts[a];
+	const size_t at = uniformIn(rng, 0, p.size() - 1);
+	switch (uniformIn(rng, 0, 3))
+	{
+	case 0: // drop a symbol, unless that would make the production epsilon
+		if (p.size() > 1)
+		{
+			p.erase(p.begin() + at);
+			break;
+		}
+		[[fallthrough]];
+	case 1: // repeat a symbol
+		p.insert(p.begin() + at, p[at]);
+		break;
+	case 2: // swap with the next symbol
+		if (at + 1 < p.size())
+		{
+			std::swap(p[at], p[at + 1]);
+			break;
+		}
+		[[fallthrough]];
+	default: // put a terminal in its place
+		p[at] = SynthSymbol{ true, uniformIn(rng, 0, g.terminalNames.size() - 1) };
+		break;
+	}
+}
+
+/*
+ * edits that keep the language: alternatives and rules (other than the start rule)
+ * are shuffled, nonterminals renamed, and some long productions split by moving
+ * their tail into a fresh nonterminal
+ */
+static void restructure(SynthGrammar& g, Rng& rng)
+{
+	const size_t originalRules = g.rules.size();
+	for (size_t r = 0; r < originalRules; ++r)
+	{
+		for (size_t a = 0; a < g.rules[r].alts.size(); ++a)
+		{
+			if (g.rules[r].alts[a].size() < 3 || !chance(rng, 0.3))
+				continue;
+			Production& p = g.rules[r].alts[a];
+			const size_t at = uniformIn(rng, 1, p.size() - 2);
+			Production tail(p.begin() + at, p.end());
+			p.erase(p.begin() + at, p.end());
+			const size_t h = addNonterminal(g, "H" + std::to_string(g.nonterminalNames.size()));
+			g.rules[h].alts.push_back(std::move(tail));
+			g.rules[r].alts[a].push_back(SynthSymbol{ false, h });
+		}
+	}
+
+	for (auto& r : g.rules)
+		std::shuffle(r.alts.begin(), r.alts.end(), rng);
+	std::shuffle(g.rules.begin() + 1, g.rules.end(), rng);
+
+	std::vector<size_t> perm(g.nonterminalNames.size());
+	for (size_t i = 0; i < perm.size(); ++i)
+		perm[i] = i;
+	std::shuffle(perm.begin(), perm.end(), rng);
+	std::vector<std::string> renamed(perm.size());
+	for (size_t i = 0; i < perm.size(); ++i)
+		renamed[i] = "R" + std::to_string(perm[i]);
+	g.nonterminalNames = std::move(renamed);
+}
+
+static void writeGrammar(const SynthGrammar& g, std::ostream& os)
+{
+	for (const auto& r : g.rules)
+	{
+		if (r.alts.empty())
+			continue;
+		os << g.nonterminalNames[r.lhs] << " ->";
+		for (size_t a = 0; a < r.alts.size(); ++a)
+		{
+			if (a > 0)
+				os << " |";
+			if (r.alts[a].empty())
+				os << " epsilon";
+			for (const auto& s : r.alts[a])
+			{
+				if (s.terminal)
+					os << " \"" << g.terminalNames[s.id] << "\"";
+				else
+					os << " " << g.nonterminalNames[s.id];
+			}
+		}
+		os << ";\n";
+	}
+}
+
+static bool writeGrammarFile(const SynthGrammar& g, const std::string& path)
+{
+	std::ofstream out(path);
+	writeGrammar(g, out);
+	out.close();
+	if (!out)
+	{
+		std::cerr << "Error: could not write " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+static bool parseSize(const char* text, size_t& out)
+{
+	char* end = nullptr;
+	const unsigned long long v = std::strtoull(text, &end, 10);
+	if (end == text || *end != '\0')
+		return false;
+	out = static_cast<size_t>(v);
+	return true;
+}
+
+static bool parseSynthOptions(int argc, char* argv[], SynthOptions& opts)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			std::cerr << "Error: " << arg << " expects a value" << std::endl;
+			return false;
+		}
+		const char* value = argv[++i];
+		size_t n = 0;
+		bool ok = true;
+		if (arg == "--seed")
+		{
+			ok = parseSize(value, n);
+			opts.seed = n;
+		}
+		else if (arg == "--nonterminals")
+		{
+			ok = parseSize(value, opts.nonterminals) && opts.nonterminals > 0;
+		}
+		else if (arg == "--alternatives")
+		{
+			ok = parseSize(value, opts.alternatives) && opts.alternatives > 0;
+		}
+		else if (arg == "--length")
+		{
+			ok = parseSize(value, opts.length) && opts.length > 0;
+		}
+		else if (arg == "--nullable")
+		{
+			char* end = nullptr;
+			opts.nullable = std::strtod(value, &end);
+			ok = end != value && *end == '\0' && opts.nullable >= 0.0 && opts.nullable <= 1.0;
+		}
+		else if (arg == "--unit-depth")
+		{
+			ok = parseSize(value, opts.unitDepth);
+		}
+		else if (arg == "--alphabet")
+		{
+			ok = parseSize(value, opts.alphabet) && opts.alphabet > 0;
+		}
+		else if (arg == "--mutations")
+		{
+			ok = parseSize(value, opts.mutations);
+		}
+		else if (arg == "--pair")
+		{
+			opts.pairPrefix = value;
+		}
+		else
+		{
+			std::cerr << "Error: unknown option " << arg << std::endl;
+			return false;
+		}
+		if (!ok)
+		{
+			std::cerr << "Error: invalid value for " << arg << ": " << value << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	SynthOptions opts;
+	if (!parseSynthOptions(argc, argv, opts))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--seed N] [--nonterminals N] [--alternatives N] [--length N]\n"
+				  << "       [--nullable P] [--unit-depth N] [--alphabet N] [--pair PREFIX [--mutations N]]\n";
+		return 1;
+	}
+
+	Rng rng(opts.seed);
+	const SynthGrammar g = generateGrammar(opts, rng);
+	if (opts.pairPrefix.empty())
+	{
+		writeGrammar(g, std::cout);
+		return 0;
+	}
+
+	SynthGrammar mutant = g;
+	for (size_t i = 0; i < opts.mutations; ++i)
+		mutateOnce(mutant, rng);
+	restructure(mutant, rng);
+
+	if (!writeGrammarFile(g, opts.pairPrefix + "_1.txt") || !writeGrammarFile(mutant, opts.pairPrefix + "_2.txt"))
+		return 1;
+	return 0;
+}
@@ -17,9 +17,25 @@
 
 #include "token.h"
 
-Token::Token(const TokenType tt, const std::string lex)
+Token::Token(const TokenType tt, std::string_view lex, size_t off)
 : tokenType(tt),
-  lexeme(lex)
+  lexeme(lex),
+  offset(off)
 {
 
 }
+
+const char* tokenTypeName(TokenType tt)
+{
+	switch (tt)
+	{
+	case TokenType::ID: return "a nonterminal";
+	case TokenType::STRING: return "a quoted terminal";
+	case TokenType::ARROW: return "'->'";
+	case TokenType::OR: return "'|'";
+	case TokenType::EPSILON: return "'epsilon'";
+	case TokenType::SEMICOLON: return "';'";
+	case TokenType::END_OF_FILE: return "end of file";
+	}
+	return "a token";
+}
@@ -18,7 +18,8 @@
 #ifndef __TOKEN_H__
 #define __TOKEN_H__
 
-#include <string>
+#include <cstddef>
+#include <string_view>
 
 enum class TokenType {
 	ID,
@@ -30,13 +31,17 @@ enum class TokenType {
 	END_OF_FILE
 }; 
 
+// how a token type is spelled in error messages
+const char* tokenTypeName(TokenType tt);
+
 
 class Token
 {
 public:
-	Token(const TokenType tt, const std::string lex);
+	Token(const TokenType tt, std::string_view lex, size_t off = 0);
 	TokenType tokenType;
-	std::string lexeme;
+	std::string_view lexeme; // points into the lexer's input, which must outlive the token
+	size_t offset; // byte offset of the token in the input
 };
 
 #endif
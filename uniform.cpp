@@ -0,0 +1,205 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "uniform.h"
+#include "analysis.h"
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+static constexpr double LOG_ZERO = -std::numeric_limits<double>::infinity();
+
+// log(exp(a) + exp(b)) without leaving log space
+static double logAdd(double a, double b)
+{
+    if (a == LOG_ZERO)
+        return b;
+    if (b == LOG_ZERO)
+        return a;
+    if (a < b)
+        std::swap(a, b);
+    return a + std::log1p(std::exp(b - a));
+}
+
+double UniformSampler::logCountOf(SymbolId A, size_t n) const
+{
+    return logCount[A * (maxLen + 1) + n];
+}
+
+// B has no trees shorter than its minimum yield, and every CNF tree has a terminal
+size_t UniformSampler::firstSplit(SymbolId B) const
+{
+    return std::max<size_t>(1, minYield[B]);
+}
+
+// likewise C needs at least its minimum yield; 0 when no split fits, as every split is at least 1
+size_t UniformSampler::lastSplit(SymbolId C, size_t n) const
+{
+    const size_t right = std::max<size_t>(1, minYield[C]);
+    return right < n ? n - right : 0;
+}
+
+/*
+ * count[A][1] = number of terminal productions of A
+ * count[A][n] = sum over A -> B C and 1 <= k < n of count[B][k] * count[C][n - k]
+ * splits that leave B or C shorter than its minimum yield count nothing and are skipped,
+ * and so are lengths below A's own minimum yield
+ */
+UniformSampler buildUniformSampler(const Grammar& g, SymbolId startSymbol, size_t maxLen)
+{
+    UniformSampler us;
+    const size_t nts = g.symbols.nonterminalCount();
+    const size_t stride = maxLen + 1;
+
+    us.maxLen = maxLen;
+    us.start = startSymbol;
+    us.termProds.resize(nts);
+    us.binProds.resize(nts);
+    us.logCount.assign(nts * stride, LOG_ZERO);
+    us.startNullable = g.acceptsEmpty(startSymbol);
+    us.minYield = minYieldLengths(g);
+
+    for (const auto& r : g.rules)
+    {
+        for (const auto& prod : r.rhs)
+        {
+            if (prod.size() == 1 && prod[0].isTerminal)
+            {
+                if (prod[0].id != EPSILON_ID)
+                    us.termProds[r.lhs].push_back(prod[0].id);
+            }
+            else if (prod.size() == 2 && !prod[0].isTerminal && !prod[1].isTerminal)
+            {
+                us.binProds[r.lhs].push_back({ prod[0].id, prod[1].id });
+            }
+        }
+    }
+
+    if (startSymbol < nts && us.startNullable)
+        us.logCount[startSymbol * stride] = 0.0;
+
+    for (size_t A = 0; A < nts && maxLen >= 1; ++A)
+    {
+        if (!us.termProds[A].empty())
+            us.logCount[A * stride + 1] = std::log(static_cast<double>(us.termProds[A].size()));
+    }
+
+    for (size_t n = 2; n <= maxLen; ++n)
+    {
+        for (size_t A = 0; A < nts; ++A)
+        {
+            if (n < us.minYield[A])
+                continue;
+
+            double total = LOG_ZERO;
+            for (const auto& [B, C] : us.binProds[A])
+            {
+                const size_t last = us.lastSplit(C, n);
+                for (size_t k = us.firstSplit(B); k <= last; ++k)
+                {
+                    const double left = us.logCount[B * stride + k];
+                    const double right = us.logCount[C * stride + n - k];
+                    if (left != LOG_ZERO && right != LOG_ZERO)
+                        total = logAdd(total, left + right);
+                }
+            }
+            us.logCount[A * stride + n] = total;
+        }
+    }
+
+    return us;
+}
+
+std::vector<size_t> feasibleLengths(const UniformSampler& us)
+{
+    std::vector<size_t> lengths;
+    if (us.start >= us.termProds.size())
+        return lengths;
+
+    for (size_t n = 0; n <= us.maxLen; ++n)
+    {
+        if (us.logCountOf(us.start, n) != LOG_ZERO)
+            lengths.push_back(n);
+    }
+    return lengths;
+}
+
+/*
+ * expands the tree top down with an explicit stack of (nonterminal, length) pairs.
+ * each choice of production and split point is made with probability proportional
+ * to the number of trees below it, which makes the whole tree uniform.
+ */
+bool sampleUniform(const UniformSampler& us, size_t n, std::mt19937_64& rng, std::vector<SymbolId>& out)
+{
+    out.clear();
+
+    if (n > us.maxLen || us.start >= us.termProds.size() || us.logCountOf(us.start, n) == LOG_ZERO)
+        return false;
+
+    if (n == 0)
+        return true;
+
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<std::pair<SymbolId, size_t>> stack;
+    stack.push_back({ us.start, n });
+
+    while (!stack.empty())
+    {
+        const auto [A, len] = stack.back();
+        stack.pop_back();
+
+        if (len == 1)
+        {
+            const auto& terms = us.termProds[A];
+            std::uniform_int_distribution<size_t> pick(0, terms.size() - 1);
+            out.push_back(terms[pick(rng)]);
+            continue;
+        }
+
+        const double logTotal = us.logCountOf(A, len);
+        double u = 1.0 - unit(rng); // in (0, 1]
+
+        // fall back to the last split with any trees if rounding leaves u unspent
+        SymbolId chosenB = NO_SYMBOL, chosenC = NO_SYMBOL;
+        size_t chosenK = 0;
+
+        for (const auto& [B, C] : us.binProds[A])
+        {
+            const size_t last = us.lastSplit(C, len);
+            for (size_t k = us.firstSplit(B); k <= last && u > 0.0; ++k)
+            {
+                const double left = us.logCountOf(B, k);
+                const double right = us.logCountOf(C, len - k);
+                if (left == LOG_ZERO || right == LOG_ZERO)
+                    continue;
+
+                chosenB = B;
+                chosenC = C;
+                chosenK = k;
+                u -= std::exp(left + right - logTotal);
+            }
+            if (u <= 0.0)
+                break;
+        }
+
+        // right child first so the left one is expanded (and emitted) first
+        stack.push_back({ chosenC, len - chosenK });
+        stack.push_back({ chosenB, chosenK });
+    }
+
+    return true;
+}
@@ -0,0 +1,61 @@
+/*
+ *    Copyright (C) 2025  Mason Sanders
+ *
+ *    This program is free software: you can redistribute it and/or modify
+ *    it under the terms of the GNU General Public License as published by
+ *    the Free Software Foundation, either version 3 of the License, or
+ *    (at your option) any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __UNIFORM_H__
+#define __UNIFORM_H__
+
+#include <vector>
+#include <random>
+#include <utility>
+#include "grammar.h"
+
+/*
+ * UniformSampler draws derivation trees of an exact length uniformly at random
+ * from a grammar in Chomsky normal form (Hickey and Cohen / McKenzie).
+ * logCount[A][n] is the natural log of the number of derivation trees of A with
+ * n terminals, kept in log space so long strings of ambiguous grammars do not overflow.
+ */
+struct UniformSampler
+{
+    size_t maxLen = 0;
+    bool startNullable = false;
+    SymbolId start = NO_SYMBOL;
+    std::vector<std::vector<SymbolId>> termProds; // A -> terminals A produces
+    std::vector<std::vector<std::pair<SymbolId, SymbolId>>> binProds; // A -> (B, C) pairs
+    std::vector<double> logCount; // nonterminalCount * (maxLen + 1)
+    std::vector<size_t> minYield; // shortest string each nonterminal derives, SIZE_MAX if none
+
+    double logCountOf(SymbolId A, size_t n) const;
+
+    // split points k of A -> B C with trees on both sides can only lie in [first, last]
+    size_t firstSplit(SymbolId B) const;
+    size_t lastSplit(SymbolId C, size_t n) const;
+};
+
+UniformSampler buildUniformSampler(const Grammar& g, SymbolId startSymbol, size_t maxLen);
+
+// lengths in [0, maxLen] that the start symbol can derive
+std::vector<size_t> feasibleLengths(const UniformSampler& us);
+
+// draw a uniformly random derivation tree of exactly n terminals, false if there is none
+bool sampleUniform(
+    const UniformSampler& us,
+    size_t n,
+    std::mt19937_64& rng,
+    std::vector<SymbolId>& out);
+
+#endif